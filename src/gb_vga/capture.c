@@ -0,0 +1,184 @@
+#include "capture.h"
+#include "framestore.h"
+#include "frame_layout.h"
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include <string.h>
+#include "lcd_capture.pio.h"
+
+// scanvideo owns pio0 and DMA_IRQ_0
+#define CAPTURE_PIO         pio1
+#define CAPTURE_PIO_IRQ     PIO1_IRQ_0
+#define CAPTURE_DMA_IRQ     DMA_IRQ_1
+
+static uint capture_sm;
+static uint capture_offset;
+static uint vsync_sm;
+static uint dma_channel;
+
+#define FRAME_WORDS         (FRAME_BYTES/sizeof(uint32_t))
+#define LINE_WORDS          (FRAME_LINE_BYTES/sizeof(uint32_t))
+
+static volatile bool capture_armed = true;   // capture SM is parked waiting for VSYNC
+static uint32_t last_vsync_us = 0;
+static bool vsync_seen = false;
+
+// Sequence lock: odd while an IRQ is updating the block, readers retry
+static volatile capture_stats_t stats;
+static volatile uint32_t stats_sequence = 0;
+
+//**********************************************************************************************
+// PRIVATE FUNCTION PROTOTYPES
+//**********************************************************************************************
+static void restart_capture(void);
+static void dma_handler(void);
+static void vsync_handler(void);
+static inline void stats_begin(void);
+static inline void stats_end(void);
+
+//**********************************************************************************************
+// PUBLIC FUNCTIONS
+//**********************************************************************************************
+void CAPTURE_init(uint8_t data_0_pin)
+{
+    capture_offset = pio_add_program(CAPTURE_PIO, &lcd_capture_program);
+    capture_sm = pio_claim_unused_sm(CAPTURE_PIO, true);
+    lcd_capture_program_init(CAPTURE_PIO, capture_sm, capture_offset, data_0_pin, PIXELS_X);
+
+    uint vsync_offset = pio_add_program(CAPTURE_PIO, &lcd_vsync_program);
+    vsync_sm = pio_claim_unused_sm(CAPTURE_PIO, true);
+    lcd_vsync_program_init(CAPTURE_PIO, vsync_sm, vsync_offset, data_0_pin + 4);
+
+    dma_channel = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(dma_channel);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, pio_get_dreq(CAPTURE_PIO, capture_sm, false));
+    dma_channel_configure(dma_channel, &c, FRAMESTORE_get_write_buffer(), &CAPTURE_PIO->rxf[capture_sm], FRAME_WORDS, true);
+
+    dma_channel_set_irq1_enabled(dma_channel, true);
+    irq_set_exclusive_handler(CAPTURE_DMA_IRQ, dma_handler);
+    irq_set_enabled(CAPTURE_DMA_IRQ, true);
+
+    pio_set_irq0_source_enabled(CAPTURE_PIO, pis_interrupt0, true);
+    irq_set_exclusive_handler(CAPTURE_PIO_IRQ, vsync_handler);
+    irq_set_enabled(CAPTURE_PIO_IRQ, true);
+
+    pio_sm_set_enabled(CAPTURE_PIO, vsync_sm, true);
+    pio_sm_set_enabled(CAPTURE_PIO, capture_sm, true);
+}
+
+uint32_t CAPTURE_get_frame_count(void)
+{
+    return stats.frames;
+}
+
+void CAPTURE_get_stats(capture_stats_t* out)
+{
+    uint32_t sequence;
+
+    do
+    {
+        sequence = stats_sequence;
+        __dmb();
+        memcpy(out, (const void*)&stats, sizeof(*out));
+        __dmb();
+    } while ((sequence & 1) || sequence != stats_sequence);
+}
+
+//**********************************************************************************************
+// PRIVATE FUNCTIONS
+//**********************************************************************************************
+// Park the capture SM on the next VSYNC and point the DMA at the frame store's write buffer
+static void restart_capture(void)
+{
+    pio_sm_set_enabled(CAPTURE_PIO, capture_sm, false);
+    pio_sm_clear_fifos(CAPTURE_PIO, capture_sm);
+    pio_sm_restart(CAPTURE_PIO, capture_sm);
+    pio_sm_exec(CAPTURE_PIO, capture_sm, pio_encode_jmp(capture_offset + lcd_capture_offset_frame));
+
+    dma_channel_set_write_addr(dma_channel, FRAMESTORE_get_write_buffer(), true);
+
+    pio_sm_set_enabled(CAPTURE_PIO, capture_sm, true);
+}
+
+// Last line of the frame has landed
+static void __not_in_flash_func(dma_handler)(void)
+{
+    dma_channel_acknowledge_irq1(dma_channel);
+
+    FRAMESTORE_publish();
+    restart_capture();
+
+    stats_begin();
+    stats.frames++;
+    stats.last_lines = PIXELS_Y;
+    stats_end();
+
+    capture_armed = true;
+}
+
+static void __not_in_flash_func(vsync_handler)(void)
+{
+    pio_interrupt_clear(CAPTURE_PIO, 0);
+
+    uint32_t now = time_us_32();
+    if (vsync_seen)
+    {
+        stats_begin();
+        stats.frame_period_us = now - last_vsync_us;
+        if (stats.frame_period_us > CAPTURE_LONG_FRAME_US)
+        {
+            stats.long_frames++;
+        }
+        stats_end();
+    }
+    last_vsync_us = now;
+    vsync_seen = true;
+
+    if (capture_armed)
+    {
+        // The capture SM saw the same edge and is now filling the buffer
+        capture_armed = false;
+    }
+    else
+    {
+        // VSYNC is back before the DMA finished: the frame was cut short (LCD
+        // switched off mid-frame or a glitch on the lines).  Throw it away and
+        // line up with the next one.
+        uint32_t lines = (FRAME_WORDS - dma_channel_hw_addr(dma_channel)->transfer_count) / LINE_WORDS;
+
+        dma_channel_set_irq1_enabled(dma_channel, false);
+        dma_channel_abort(dma_channel);
+        dma_channel_acknowledge_irq1(dma_channel);
+        dma_channel_set_irq1_enabled(dma_channel, true);
+
+        restart_capture();
+        capture_armed = true;
+
+        stats_begin();
+        stats.resyncs++;
+        stats.last_lines = lines;
+        if (lines < PIXELS_Y)
+        {
+            stats.short_frames++;
+        }
+        stats_end();
+    }
+}
+
+static inline void stats_begin(void)
+{
+    stats_sequence++;
+    __dmb();
+}
+
+static inline void stats_end(void)
+{
+    __dmb();
+    stats_sequence++;
+}
@@ -0,0 +1,30 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// data_0_pin is the first of five consecutive inputs:
+// DATA_0, DATA_1, PIXEL_CLOCK, HSYNC, VSYNC
+// Frames are written into the frame store and published as they complete.
+// Nominal DMG frame is 70224 dots at 4.194304 MHz
+#define CAPTURE_FRAME_US        (16743)
+#define CAPTURE_LONG_FRAME_US   (CAPTURE_FRAME_US + CAPTURE_FRAME_US/8)
+
+typedef struct
+{
+    uint32_t frames;            // complete frames published
+    uint32_t short_frames;      // VSYNC came back before all PIXELS_Y lines were in
+    uint32_t long_frames;       // VSYNC period over CAPTURE_LONG_FRAME_US, e.g. LCD switched off
+    uint32_t resyncs;           // capture restarted mid-frame to line up with VSYNC again
+    uint32_t last_lines;        // lines captured in the most recent frame
+    uint32_t frame_period_us;   // most recent VSYNC to VSYNC
+} capture_stats_t;
+
+void CAPTURE_init(uint8_t data_0_pin);
+uint32_t CAPTURE_get_frame_count(void);
+
+// Safe from either core; written only by the capture IRQs
+void CAPTURE_get_stats(capture_stats_t* stats);
+
+#endif // CAPTURE_H
@@ -0,0 +1,522 @@
+#include "controller.h"
+#include "controller_profile.h"
+#include "i2c_bus.h"
+#include "nes_pad.h"
+#include "hardware/sync.h"
+#include <string.h>
+
+#define CONTROLLER_I2C_ADDRESS  (0x52)
+#define CONTROLLER_I2C_BAUDRATE (400*1000)
+
+#define BOOT_DELAY_US           (2000*1000)     // controller power up
+#define HANDSHAKE_1_DELAY_US    (10*1000)
+#define HANDSHAKE_2_DELAY_US    (20*1000)
+#define POINTER_DELAY_US        (1000)          // register pointer write to read
+#define RETRY_DELAY_US          (1000*1000)     // after losing the controller
+#define TRANSFER_TIMEOUT_US     (5000)          // a few bytes take ~200us at 400kHz
+#define MAX_POLL_ERRORS         (3)             // in a row, before starting over
+
+// Pointer write to decoded report is one pointer delay plus a tick for each of
+// the two transfers to be seen done, plus up to a tick starting late
+#define POLL_LEAD_US            (POINTER_DELAY_US + 3*CONTROLLER_TICK_US + 250)
+
+// An NES pad read is done within the tick after it starts
+#define NES_POLL_LEAD_US        (2*CONTROLLER_TICK_US + 250)
+
+// Joypad read tracking.  Edges closer than READ_GAP_US belong to the same
+// read; reads further apart than the period limits are not a frame rhythm.
+#define READ_GAP_US             (2000)
+#define MIN_READ_PERIOD_US      (5000)
+#define MAX_READ_PERIOD_US      (50000)
+#define SYNC_SAMPLES            (8)             // steady periods in a row before locking
+#define SYNC_LOST_PERIODS       (4)             // reads missed before running free again
+
+typedef enum
+{
+    STATE_HANDSHAKE_1 = 0,  // 0xF0 = 0x55, then
+    STATE_HANDSHAKE_2,      // 0xFB = 0x00: unencrypted reports
+    STATE_ID_POINTER,       // register pointer to 0xFA, then
+    STATE_ID_READ,          // the ID, which picks the profile
+    STATE_POINTER,          // register pointer back to 0x00
+    STATE_READ,             // the report
+    STATE_NES_READ,         // the NES pad's shift register, instead of all the above
+} controller_state_t;
+
+static controller_state_t state = STATE_HANDSHAKE_1;
+static bool nes_pad = false;
+static uint32_t poll_lead_us = POLL_LEAD_US;
+static bool in_flight = false;
+static uint32_t wake_us = 0;            // next transfer not before
+static uint32_t started_us = 0;         // transfer in flight since
+static uint32_t poll_us = 0;            // current poll was due, for the poll period
+static int poll_errors = 0;
+static int poll_hz = CONTROLLER_DEFAULT_POLL_HZ;
+static bool sync_enabled = true;
+static uint8_t report[CONTROLLER_PROFILE_MAX_REPORT];    // also takes the ID
+static const controller_profile_t* volatile profile = NULL;     // NULL until identified
+
+static volatile uint16_t buttons = 0;
+static volatile bool connected = false;
+static volatile uint32_t buttons_us = 0;    // when the buttons were last decoded
+
+// Learned joypad read schedule, written by the joypad read handler under a sequence lock
+static volatile uint32_t read_us = 0;       // start of the last read
+static volatile uint32_t read_period_us = 0;    // 0 until locked
+static volatile uint32_t read_sequence = 0;
+
+// Joypad read handler only
+static uint32_t last_edge_us = 0;
+static uint32_t period_estimate_us = 0;
+static int period_samples = 0;
+static volatile controller_latency_t latency;
+
+// Sequence lock: odd while the tick is updating the block, readers retry
+static volatile controller_stats_t stats;
+static volatile uint32_t stats_sequence = 0;
+
+//**********************************************************************************************
+// PRIVATE FUNCTION PROTOTYPES
+//**********************************************************************************************
+static void reset(uint32_t now_us, controller_state_t first_state, uint32_t delay_us);
+static i2c_bus_status_t transfer_status(void);
+static void start_transfer(uint32_t now_us);
+static void transfer_done(uint32_t now_us);
+static void transfer_failed(uint32_t now_us);
+static void start_over(uint32_t now_us);
+static bool decode_report(uint32_t now_us);
+static uint32_t next_poll_us(uint32_t now_us);
+static bool get_read_schedule(uint32_t now_us, uint32_t* last_read_us, uint32_t* period_us);
+static void learn_read_period(uint32_t now_us);
+static void record_age(uint32_t now_us);
+static inline void stats_begin(void);
+static inline void stats_end(void);
+
+//**********************************************************************************************
+// PUBLIC FUNCTIONS
+//**********************************************************************************************
+void CONTROLLER_init(uint32_t now_us)
+{
+    I2C_BUS_init(CONTROLLER_I2C_ADDRESS, CONTROLLER_I2C_BAUDRATE);
+
+    nes_pad = false;
+    poll_lead_us = POLL_LEAD_US;
+    profile = NULL;
+    reset(now_us, STATE_HANDSHAKE_1, BOOT_DELAY_US);
+}
+
+bool CONTROLLER_init_nes_pad(uint32_t now_us, uint8_t latch_pin, uint8_t clock_pin, uint8_t data_pin)
+{
+    if (!NES_PAD_init(latch_pin, clock_pin, data_pin))
+        return false;
+
+    nes_pad = true;
+    poll_lead_us = NES_POLL_LEAD_US;
+    profile = CONTROLLER_PROFILE_nes_pad();
+    reset(now_us, STATE_NES_READ, 0);
+    return true;
+}
+
+void CONTROLLER_set_poll_rate(int hz)
+{
+    hz = hz < CONTROLLER_MIN_POLL_HZ ? CONTROLLER_MIN_POLL_HZ : hz;
+    hz = hz > CONTROLLER_MAX_POLL_HZ ? CONTROLLER_MAX_POLL_HZ : hz;
+    poll_hz = hz;
+}
+
+int CONTROLLER_get_poll_rate(void)
+{
+    return poll_hz;
+}
+
+bool CONTROLLER_joypad_read(uint32_t now_us)
+{
+    uint32_t since_edge = now_us - last_edge_us;
+    last_edge_us = now_us;
+
+    // Games select the D-pad several times within one read
+    if (since_edge < READ_GAP_US)
+        return false;
+
+    learn_read_period(now_us);
+    record_age(now_us);
+    return true;
+}
+
+void CONTROLLER_set_sync_enabled(bool enabled)
+{
+    sync_enabled = enabled;
+}
+
+bool CONTROLLER_is_synced(uint32_t now_us)
+{
+    uint32_t last_read, period;
+    return sync_enabled && get_read_schedule(now_us, &last_read, &period);
+}
+
+uint32_t CONTROLLER_get_read_period_us(void)
+{
+    return read_period_us;
+}
+
+void CONTROLLER_tick(uint32_t now_us)
+{
+    if (in_flight)
+    {
+        i2c_bus_status_t status = transfer_status();
+
+        if (status == I2C_BUS_BUSY)
+        {
+            if (now_us - started_us > TRANSFER_TIMEOUT_US)
+            {
+                if (!nes_pad)
+                {
+                    I2C_BUS_abort();
+                }
+                in_flight = false;
+                transfer_failed(now_us);
+            }
+            return;
+        }
+
+        in_flight = false;
+        if (status == I2C_BUS_DONE)
+        {
+            transfer_done(now_us);
+        }
+        else
+        {
+            transfer_failed(now_us);
+        }
+        return;
+    }
+
+    if ((int32_t)(now_us - wake_us) >= 0)
+    {
+        start_transfer(now_us);
+    }
+}
+
+uint16_t CONTROLLER_get_buttons(void)
+{
+    return buttons;
+}
+
+bool CONTROLLER_is_connected(void)
+{
+    return connected;
+}
+
+const char* CONTROLLER_get_profile_name(void)
+{
+    const controller_profile_t* p = profile;
+    return p ? p->name : "NONE";
+}
+
+void CONTROLLER_get_stats(controller_stats_t* out)
+{
+    uint32_t sequence;
+
+    do
+    {
+        sequence = stats_sequence;
+        __dmb();
+        memcpy(out, (const void*)&stats, sizeof(*out));
+        __dmb();
+    } while ((sequence & 1) || sequence != stats_sequence);
+}
+
+void CONTROLLER_get_latency(controller_latency_t* out)
+{
+    memcpy(out, (const void*)&latency, sizeof(*out));
+}
+
+uint32_t CONTROLLER_age_percentile(const controller_latency_t* ages, int percent)
+{
+    if (ages->reads == 0)
+        return 0;
+
+    // Walk down from the oldest bucket until (100 - percent)% of the reads are above us
+    uint32_t above = 0;
+    uint32_t limit = (uint64_t)ages->reads * (100 - percent) / 100;
+    int bucket = CONTROLLER_AGE_BUCKETS - 1;
+    while (bucket > 0 && above + ages->histogram[bucket] <= limit)
+    {
+        above += ages->histogram[bucket];
+        bucket--;
+    }
+    return (bucket + 1) * CONTROLLER_AGE_BUCKET_US;
+}
+
+//**********************************************************************************************
+// PRIVATE FUNCTIONS
+//**********************************************************************************************
+static void reset(uint32_t now_us, controller_state_t first_state, uint32_t delay_us)
+{
+    state = first_state;
+    in_flight = false;
+    wake_us = now_us + delay_us;
+    poll_errors = 0;
+    buttons = 0;
+    connected = false;
+    memset((void*)&stats, 0, sizeof(stats));
+}
+
+// The NES pad's reads cannot fail; one is busy until its result is in
+static i2c_bus_status_t transfer_status(void)
+{
+    if (state == STATE_NES_READ)
+        return NES_PAD_result(report) ? I2C_BUS_DONE : I2C_BUS_BUSY;
+
+    return I2C_BUS_status();
+}
+
+static void start_transfer(uint32_t now_us)
+{
+    static const uint8_t handshake_1[] = { 0xF0, 0x55 };
+    static const uint8_t handshake_2[] = { 0xFB, 0x00 };
+    static const uint8_t id_pointer[] = { 0xFA };
+    static const uint8_t pointer[] = { 0x00 };
+
+    switch (state)
+    {
+        case STATE_HANDSHAKE_1:
+            stats_begin();
+            stats.handshakes++;
+            stats_end();
+            I2C_BUS_write(handshake_1, sizeof(handshake_1));
+            break;
+        case STATE_HANDSHAKE_2:
+            I2C_BUS_write(handshake_2, sizeof(handshake_2));
+            break;
+        case STATE_ID_POINTER:
+            I2C_BUS_write(id_pointer, sizeof(id_pointer));
+            break;
+        case STATE_ID_READ:
+            I2C_BUS_read(report, CONTROLLER_PROFILE_ID_BYTES);
+            break;
+        case STATE_POINTER:
+            poll_us = wake_us;
+            I2C_BUS_write(pointer, sizeof(pointer));
+            break;
+        case STATE_READ:
+            I2C_BUS_read(report, profile->report_bytes);
+            break;
+        case STATE_NES_READ:
+            poll_us = wake_us;
+            NES_PAD_start();
+            break;
+    }
+
+    in_flight = true;
+    started_us = now_us;
+}
+
+static void transfer_done(uint32_t now_us)
+{
+    switch (state)
+    {
+        case STATE_HANDSHAKE_1:
+            state = STATE_HANDSHAKE_2;
+            wake_us = now_us + HANDSHAKE_1_DELAY_US;
+            break;
+        case STATE_HANDSHAKE_2:
+            state = STATE_ID_POINTER;
+            wake_us = now_us + HANDSHAKE_2_DELAY_US;
+            break;
+        case STATE_ID_POINTER:
+            state = STATE_ID_READ;
+            wake_us = now_us + POINTER_DELAY_US;
+            break;
+        case STATE_ID_READ:
+            // Once per handshake, so every poll after decodes without asking
+            profile = CONTROLLER_PROFILE_identify(report);
+            state = STATE_POINTER;
+            wake_us = now_us;
+            break;
+        case STATE_POINTER:
+            state = STATE_READ;
+            wake_us = now_us + POINTER_DELAY_US;
+            break;
+        case STATE_READ:
+        case STATE_NES_READ:
+            if (!decode_report(now_us))
+            {
+                // A controller swapped in or reset needs the handshake again
+                stats_begin();
+                stats.invalid_reads++;
+                stats_end();
+                start_over(now_us);
+                return;
+            }
+            poll_errors = 0;
+            state = nes_pad ? STATE_NES_READ : STATE_POINTER;
+            wake_us = next_poll_us(now_us);
+            break;
+    }
+}
+
+// A poll that fails now and then is retried next period with the buttons
+// left as they were; anything else starts over
+static void transfer_failed(uint32_t now_us)
+{
+    stats_begin();
+    stats.bus_errors++;
+    stats_end();
+
+    bool polling = state == STATE_POINTER || state == STATE_READ || state == STATE_NES_READ;
+    if (polling && ++poll_errors < MAX_POLL_ERRORS)
+    {
+        state = nes_pad ? STATE_NES_READ : STATE_POINTER;
+        wake_us = next_poll_us(now_us);
+        return;
+    }
+
+    start_over(now_us);
+}
+
+// Lost the controller: release everything so nothing stays held, and
+// handshake again after a while, identifying whatever is plugged in then
+static void start_over(uint32_t now_us)
+{
+    buttons = 0;
+    connected = false;
+    poll_errors = 0;
+    if (!nes_pad)
+    {
+        profile = NULL;
+    }
+    state = nes_pad ? STATE_NES_READ : STATE_HANDSHAKE_1;
+    wake_us = now_us + RETRY_DELAY_US;
+}
+
+static bool decode_report(uint32_t now_us)
+{
+    // An I2C controller that lost its setup answers all 0xFF, where live
+    // data has the sticks somewhere off the end stops
+    if (!nes_pad)
+    {
+        uint8_t all = 0xFF;
+        for (int i = 0; i < profile->report_bytes; i++)
+        {
+            all &= report[i];
+        }
+        if (all == 0xFF)
+            return false;
+    }
+
+    uint16_t pressed = CONTROLLER_PROFILE_decode(profile, report);
+
+    buttons = pressed;
+    buttons_us = now_us;
+    connected = true;
+
+    stats_begin();
+    stats.polls++;
+    stats_end();
+
+    return true;
+}
+
+// Start of the next poll.  Synced, the polls split the read period evenly
+// with one ending poll_lead_us before each predicted read.
+static uint32_t next_poll_us(uint32_t now_us)
+{
+    uint32_t free_us = 1000000 / poll_hz;
+    uint32_t last_read, period;
+
+    if (!sync_enabled || !get_read_schedule(now_us, &last_read, &period))
+    {
+        // Keeps the rate whichever tick the poll started on; after a stall,
+        // resumes now rather than catching up
+        uint32_t next = poll_us + free_us;
+        return (int32_t)(next - now_us) > 0 ? next : now_us;
+    }
+
+    uint32_t polls = (period + free_us / 2) / free_us;
+    uint32_t spacing = period / (polls ? polls : 1);
+
+    // First read whose poll has not started yet, then back off to the
+    // earliest of its slots still ahead
+    uint32_t target = last_read - poll_lead_us;
+    while ((int32_t)(target - now_us) <= 0)
+    {
+        target += period;
+    }
+    while ((int32_t)(target - spacing - now_us) > 0)
+    {
+        target -= spacing;
+    }
+    return target;
+}
+
+static bool get_read_schedule(uint32_t now_us, uint32_t* last_read, uint32_t* period)
+{
+    uint32_t sequence;
+
+    do
+    {
+        sequence = read_sequence;
+        __dmb();
+        *last_read = read_us;
+        *period = read_period_us;
+        __dmb();
+    } while ((sequence & 1) || sequence != read_sequence);
+
+    return *period != 0 && now_us - *last_read < SYNC_LOST_PERIODS * *period;
+}
+
+static void learn_read_period(uint32_t now_us)
+{
+    uint32_t interval = now_us - read_us;
+
+    if (interval < MIN_READ_PERIOD_US || interval > MAX_READ_PERIOD_US)
+    {
+        period_samples = 0;
+    }
+    else if (period_samples == 0
+             || interval > period_estimate_us + period_estimate_us / 4
+             || interval < period_estimate_us - period_estimate_us / 4)
+    {
+        // A new rhythm, e.g. after a pause or a lag frame
+        period_estimate_us = interval;
+        period_samples = 1;
+    }
+    else
+    {
+        period_estimate_us += ((int32_t)interval - (int32_t)period_estimate_us) / 8;
+        period_samples++;
+    }
+
+    read_sequence++;
+    __dmb();
+    read_us = now_us;
+    read_period_us = period_samples >= SYNC_SAMPLES ? period_estimate_us : 0;
+    __dmb();
+    read_sequence++;
+}
+
+static void record_age(uint32_t now_us)
+{
+    if (!connected)
+        return;
+
+    uint32_t age = now_us - buttons_us;
+    uint32_t bucket = age / CONTROLLER_AGE_BUCKET_US;
+    bucket = bucket >= CONTROLLER_AGE_BUCKETS ? CONTROLLER_AGE_BUCKETS - 1 : bucket;
+
+    latency.histogram[bucket]++;
+    latency.reads++;
+    latency.worst_us = age > latency.worst_us ? age : latency.worst_us;
+}
+
+static inline void stats_begin(void)
+{
+    stats_sequence++;
+    __dmb();
+}
+
+static inline void stats_end(void)
+{
+    __dmb();
+    stats_sequence++;
+}
@@ -0,0 +1,102 @@
+#ifndef CONTROLLER_H
+#define CONTROLLER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Wii Classic / NES Classic controller on I2C, polled by a state machine that
+// is stepped from a timer interrupt and never waits on the bus.  The
+// controller's ID is read once per handshake to pick its profile, see
+// controller_profile.h.  An original NES pad can be polled instead.
+//
+// Once the game's joypad reads have been seen often enough to predict the
+// next one, polls are placed so a report is decoded just ahead of each read;
+// otherwise they run free at the poll rate.
+#define CONTROLLER_TICK_US      (250)       // how often CONTROLLER_tick() should run
+#define CONTROLLER_DEFAULT_POLL_HZ  (60)
+#define CONTROLLER_MIN_POLL_HZ  (30)
+#define CONTROLLER_MAX_POLL_HZ  (400)       // a poll takes ~1.75ms of bus and waits
+
+// Age of the button data at each joypad read, 1ms per bucket
+#define CONTROLLER_AGE_BUCKETS      (24)
+#define CONTROLLER_AGE_BUCKET_US    (1000)
+
+typedef enum
+{
+    BUTTON_A = 0,
+    BUTTON_B,
+    BUTTON_SELECT,
+    BUTTON_START,
+    BUTTON_UP,
+    BUTTON_DOWN,
+    BUTTON_LEFT,
+    BUTTON_RIGHT,
+    BUTTON_HOME,
+    BUTTON_MACRO,           // plays the macro picked in turbo.h
+    BUTTON_COUNT
+} controller_button_t;
+
+typedef struct
+{
+    uint32_t polls;             // reads decoded into button states
+    uint32_t bus_errors;        // NACKs and transfer timeouts
+    uint32_t invalid_reads;     // answered, but not with button data
+    uint32_t handshakes;        // init sequences started
+} controller_stats_t;
+
+// Fields are single words written by the joypad read handler only, as in linestats.h
+typedef struct
+{
+    uint32_t reads;             // joypad reads seen while a controller was connected
+    uint32_t worst_us;
+    uint32_t histogram[CONTROLLER_AGE_BUCKETS];     // last bucket also counts overflow
+} controller_latency_t;
+
+// Sets up the I2C bus; the first handshake follows a power up delay
+void CONTROLLER_init(uint32_t now_us);
+
+// Instead of CONTROLLER_init(), for an original NES pad read by nes_pad.h.
+// There is nothing to tell it is plugged in: it always counts as connected.
+// false if the pad's PIO program did not fit; call CONTROLLER_init() then.
+bool CONTROLLER_init_nes_pad(uint32_t now_us, uint8_t latch_pin, uint8_t clock_pin, uint8_t data_pin);
+
+// Advances the state machine by whatever is due at now_us
+void CONTROLLER_tick(uint32_t now_us);
+
+// Polls per second.  While locked to the game's joypad reads this is rounded
+// to a whole number of polls per read, one of them just before it.
+void CONTROLLER_set_poll_rate(int hz);
+int CONTROLLER_get_poll_rate(void);
+
+// Call on the falling edge of the D-pad select line (P14), the start of a
+// joypad read.  Cheap enough for an interrupt handler; call it from one
+// handler only.  True for the first edge of a read, games select the D-pad
+// several times in one.
+bool CONTROLLER_joypad_read(uint32_t now_us);
+
+// On by default; off, polls always run free, e.g. to compare latency
+void CONTROLLER_set_sync_enabled(bool enabled);
+
+// True while polls follow the learned joypad read schedule
+bool CONTROLLER_is_synced(uint32_t now_us);
+uint32_t CONTROLLER_get_read_period_us(void);
+
+// Bit per controller_button_t, set while held.  Published as one store, so
+// safe to read from either core or an interrupt.  All clear while no
+// controller answers.
+uint16_t CONTROLLER_get_buttons(void);
+bool CONTROLLER_is_connected(void);
+
+// Of the identified profile, "NONE" before a controller has answered
+const char* CONTROLLER_get_profile_name(void);
+
+// Safe from core 0 while the tick interrupt runs there
+void CONTROLLER_get_stats(controller_stats_t* stats);
+
+void CONTROLLER_get_latency(controller_latency_t* latency);
+
+// Upper edge of the bucket holding the given percentile of a histogram,
+// e.g. the difference of two snapshots; 0 if it is empty
+uint32_t CONTROLLER_age_percentile(const controller_latency_t* latency, int percent);
+
+#endif // CONTROLLER_H
@@ -0,0 +1,77 @@
+#include "controller_profile.h"
+#include "controller.h"
+#include <string.h>
+
+// Report byte, bit, button.  Wii Classic Controller, data format 1: byte 4
+// is right, down, L, minus, home, plus, R; byte 5 ZL, B, Y, A, X, ZR, left,
+// up, from the top bit down.  R and ZR play the macro.
+#define CLASSIC_BITS(X) \
+    X(4, 7, RIGHT)  X(4, 6, DOWN)   X(4, 4, SELECT) X(4, 3, HOME)   X(4, 2, START) \
+    X(5, 6, B)      X(5, 4, A)      X(5, 1, LEFT)   X(5, 0, UP) \
+    X(4, 1, MACRO)  X(5, 2, MACRO)
+
+// Classic Controller Pro, SNES and NES Classic pads: the same report, with Y
+// and X doubling as B and A so either pair of face buttons plays
+#define PRO_BITS(X) \
+    CLASSIC_BITS(X) \
+    X(5, 5, B)      X(5, 3, A)
+
+// Original NES pad, in the order its 4021 shifts them out
+#define NES_BITS(X) \
+    X(0, 0, A)      X(0, 1, B)      X(0, 2, SELECT) X(0, 3, START) \
+    X(0, 4, UP)     X(0, 5, DOWN)   X(0, 6, LEFT)   X(0, 7, RIGHT)
+
+#define PROFILE_BIT(byte, bit, button)  { (byte), 1 << (bit), 1 << BUTTON_##button },
+#define PROFILE_BITS(table)             (table), sizeof(table)/sizeof((table)[0])
+
+static const controller_profile_bit_t classic_bits[] = { CLASSIC_BITS(PROFILE_BIT) };
+static const controller_profile_bit_t pro_bits[] = { PRO_BITS(PROFILE_BIT) };
+static const controller_profile_bit_t nes_bits[] = { NES_BITS(PROFILE_BIT) };
+
+// Searched in order; the last is the fallback for unknown IDs
+static const controller_profile_t i2c_profiles[] =
+{
+    { "WII CLASSIC",    { 0x00, 0x00, 0xA4, 0x20, 0x01, 0x01 }, 6, true, PROFILE_BITS(classic_bits) },
+    { "CLASSIC PRO",    { 0x01, 0x00, 0xA4, 0x20, 0x01, 0x01 }, 6, true, PROFILE_BITS(pro_bits) },
+    { "CLASSIC CLONE",  { 0 },                                  6, true, PROFILE_BITS(classic_bits) },
+};
+
+static const controller_profile_t nes_profile =
+{
+    "NES PAD", { 0 }, 1, false, PROFILE_BITS(nes_bits)
+};
+
+#define I2C_PROFILES    (sizeof(i2c_profiles)/sizeof(i2c_profiles[0]))
+
+//**********************************************************************************************
+// PUBLIC FUNCTIONS
+//**********************************************************************************************
+const controller_profile_t* CONTROLLER_PROFILE_identify(const uint8_t id[CONTROLLER_PROFILE_ID_BYTES])
+{
+    for (size_t i = 0; i < I2C_PROFILES - 1; i++)
+    {
+        if (memcmp(i2c_profiles[i].id, id, CONTROLLER_PROFILE_ID_BYTES) == 0)
+            return &i2c_profiles[i];
+    }
+    return &i2c_profiles[I2C_PROFILES - 1];
+}
+
+const controller_profile_t* CONTROLLER_PROFILE_nes_pad(void)
+{
+    return &nes_profile;
+}
+
+uint16_t CONTROLLER_PROFILE_decode(const controller_profile_t* profile, const uint8_t* report)
+{
+    uint16_t pressed = 0;
+
+    for (int i = 0; i < profile->bit_count; i++)
+    {
+        const controller_profile_bit_t* b = &profile->bits[i];
+        if (!(report[b->byte] & b->mask))
+        {
+            pressed |= b->buttons;
+        }
+    }
+    return pressed;
+}
@@ -0,0 +1,39 @@
+#ifndef CONTROLLER_PROFILE_H
+#define CONTROLLER_PROFILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// How to read one kind of controller: the ID it answers with, how long its
+// report is and which report bits are which button.  The bit tables are
+// generated at compile time from the lists in controller_profile.c.
+#define CONTROLLER_PROFILE_ID_BYTES     (6)     // I2C register 0xFA
+#define CONTROLLER_PROFILE_MAX_REPORT   (6)
+
+typedef struct
+{
+    uint8_t byte;
+    uint8_t mask;               // clear while held
+    uint16_t buttons;           // bit per controller_button_t
+} controller_profile_bit_t;
+
+typedef struct
+{
+    const char* name;           // at most 14 characters, for the OSD
+    uint8_t id[CONTROLLER_PROFILE_ID_BYTES];
+    uint8_t report_bytes;
+    bool i2c;                   // else the original NES pad's shift register
+    const controller_profile_bit_t* bits;
+    uint8_t bit_count;
+} controller_profile_t;
+
+// Profile for an I2C controller's ID bytes.  IDs not in the table get the
+// plain Classic Controller layout, which clones follow.
+const controller_profile_t* CONTROLLER_PROFILE_identify(const uint8_t id[CONTROLLER_PROFILE_ID_BYTES]);
+
+const controller_profile_t* CONTROLLER_PROFILE_nes_pad(void);
+
+// One pass over the profile's bit table
+uint16_t CONTROLLER_PROFILE_decode(const controller_profile_t* profile, const uint8_t* report);
+
+#endif // CONTROLLER_PROFILE_H
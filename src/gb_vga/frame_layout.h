@@ -0,0 +1,20 @@
+#ifndef FRAME_LAYOUT_H
+#define FRAME_LAYOUT_H
+
+#define PIXELS_X                (160)
+#define PIXELS_Y                (144)
+
+#define PIXEL_COUNT             (PIXELS_X*PIXELS_Y)
+
+// Captured frames are packed 2bpp, four pixels per byte, leftmost pixel in
+// the low bits:  byte = p0 | p1 << 2 | p2 << 4 | p3 << 6
+// This is what lcd_capture.pio produces with a right-shifting ISR, and each
+// line is a whole number of 32-bit words.
+#define FRAME_BITS_PER_PIXEL    (2)
+#define FRAME_PIXELS_PER_BYTE   (8/FRAME_BITS_PER_PIXEL)
+#define FRAME_LINE_BYTES        (PIXELS_X/FRAME_PIXELS_PER_BYTE)
+#define FRAME_BYTES             (FRAME_LINE_BYTES*PIXELS_Y)
+
+#define FRAME_PIXEL(byte, n)    (((byte) >> ((n)*FRAME_BITS_PER_PIXEL)) & 0x3)
+
+#endif // FRAME_LAYOUT_H
@@ -0,0 +1,168 @@
+#include "framestore.h"
+#include "pico.h"
+#include "hardware/sync.h"
+#include <string.h>
+
+static framestore_frame_t buffers[FRAMESTORE_BUFFERS] __attribute__((aligned(4)));
+
+// Capture owns write_index, the renderer owns read_index and previous_index.
+// latest_index is the hand-off: capture publishes into it, the renderer
+// latches from it.
+static volatile uint8_t write_index;
+static volatile uint8_t latest_index;
+static volatile uint8_t read_index;
+static volatile uint8_t previous_index;
+
+// Bumped every time capture starts filling a buffer again
+static volatile uint32_t buffer_sequence[FRAMESTORE_BUFFERS];
+
+static volatile bool latest_shown;
+static uint32_t latched_sequence;
+static uint32_t latched_published;
+
+static volatile framestore_stats_t stats;
+
+//**********************************************************************************************
+// PRIVATE FUNCTION PROTOTYPES
+//**********************************************************************************************
+static void hash_lines(framestore_frame_t* frame);
+
+//**********************************************************************************************
+// PUBLIC FUNCTIONS
+//**********************************************************************************************
+void FRAMESTORE_init(void)
+{
+    memset(buffers, 0, sizeof(buffers));
+    memset((void*)&stats, 0, sizeof(stats));
+
+    // Until the first capture lands the renderer shows a blank frame
+    latest_index = FRAMESTORE_BUFFERS - 1;
+    read_index = latest_index;
+    previous_index = latest_index;
+    write_index = 0;
+    latest_shown = true;
+
+    for (int i = 0; i < FRAMESTORE_BUFFERS; i++)
+    {
+        buffer_sequence[i] = 0;
+    }
+    latched_sequence = 0;
+    latched_published = 0;
+}
+
+uint8_t* FRAMESTORE_get_write_buffer(void)
+{
+    return buffers[write_index].data;
+}
+
+void FRAMESTORE_publish(void)
+{
+    uint8_t finished = write_index;
+
+    hash_lines(&buffers[finished]);
+
+    if (!latest_shown)
+    {
+        stats.dropped++;
+    }
+    latest_shown = false;
+    stats.published++;
+
+    __dmb();
+    latest_index = finished;
+    __dmb();
+
+    // Next buffer: not the one on screen, the one just published or the
+    // previous frame.  With too few buffers give them up in reverse order:
+    // a stale previous frame only upsets blending.
+    uint8_t reading = read_index;
+    uint8_t keeping = previous_index;
+    uint8_t next = finished;
+    int next_score = -1;
+    for (uint8_t i = 0; i < FRAMESTORE_BUFFERS; i++)
+    {
+        int score = (i != reading) * 4 + (i != finished) * 2 + (i != keeping);
+        if (score > next_score)
+        {
+            next = i;
+            next_score = score;
+        }
+    }
+
+    write_index = next;
+    buffer_sequence[next]++;
+}
+
+const framestore_frame_t* FRAMESTORE_latch(void)
+{
+    // Did capture start rewriting the previous frame's buffer while it was on screen?
+    if (buffer_sequence[read_index] != latched_sequence)
+    {
+        stats.torn++;
+    }
+
+    // The frame going off screen becomes the previous one.  Hold it before
+    // letting go of read_index so capture never sees it unclaimed.
+    uint8_t shown = read_index;
+    uint8_t kept = previous_index;
+    previous_index = shown;
+    __dmb();
+
+    // Capture may publish between reading latest_index and claiming it in
+    // read_index; go round again until the claim matches what is latest.
+    uint8_t index;
+    do
+    {
+        index = latest_index;
+        read_index = index;
+        __dmb();
+    } while (index != latest_index);
+
+    // Showing the same frame again: keep the one before it
+    if (index == shown)
+    {
+        previous_index = kept;
+    }
+
+    latched_sequence = buffer_sequence[index];
+    latest_shown = true;
+
+    uint32_t published = stats.published;
+    if (published == latched_published)
+    {
+        stats.repeated++;
+    }
+    latched_published = published;
+    stats.displayed++;
+
+    return &buffers[index];
+}
+
+const framestore_frame_t* FRAMESTORE_get_previous(void)
+{
+    return &buffers[previous_index];
+}
+
+void FRAMESTORE_get_stats(framestore_stats_t* out)
+{
+    memcpy(out, (const void*)&stats, sizeof(*out));
+}
+
+//**********************************************************************************************
+// PRIVATE FUNCTIONS
+//**********************************************************************************************
+// FNV-1a over whole words: ten multiplies per line, cheap enough for the DMA IRQ
+static void __not_in_flash_func(hash_lines)(framestore_frame_t* frame)
+{
+    const uint32_t* p = (const uint32_t*)frame->data;
+
+    for (int y = 0; y < PIXELS_Y; y++)
+    {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < FRAME_LINE_BYTES / sizeof(uint32_t); i++)
+        {
+            hash = (hash ^ *p++) * 16777619u;
+        }
+        frame->line_hash[y] = hash;
+    }
+}
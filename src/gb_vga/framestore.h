@@ -0,0 +1,45 @@
+#ifndef FRAMESTORE_H
+#define FRAMESTORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "frame_layout.h"
+
+// 1 = capture writes the buffer on screen (tears), 2 = double, 3 = triple,
+// 4 = triple plus the previous frame held for frame blending.  Frames stay
+// packed 2bpp, so the fourth buffer costs FRAME_BYTES and the line hashes.
+#ifndef FRAMESTORE_BUFFERS
+#define FRAMESTORE_BUFFERS      (4)
+#endif
+
+typedef struct
+{
+    uint8_t data[FRAME_BYTES];
+    uint32_t line_hash[PIXELS_Y];   // filled in on publish, equal hashes mean an unchanged line
+} framestore_frame_t;
+
+typedef struct
+{
+    uint32_t published;     // frames completed by capture
+    uint32_t displayed;     // output frames started by the renderer
+    uint32_t repeated;      // output frames that had no new capture to show
+    uint32_t dropped;       // captured frames replaced before they were ever shown
+    uint32_t torn;          // output frames whose buffer capture started rewriting mid-frame
+} framestore_stats_t;
+
+void FRAMESTORE_init(void);
+
+// Capture side (core 0)
+uint8_t* FRAMESTORE_get_write_buffer(void);
+void FRAMESTORE_publish(void);
+
+// Render side, once at the start of each output frame
+const framestore_frame_t* FRAMESTORE_latch(void);
+
+// The frame latched before the current one, skipping repeats.  Only kept out
+// of capture's way with four or more buffers.
+const framestore_frame_t* FRAMESTORE_get_previous(void);
+
+void FRAMESTORE_get_stats(framestore_stats_t* stats);
+
+#endif // FRAMESTORE_H
@@ -10,6 +10,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "time.h"
 #include "pico.h"
 #include "pico/stdlib.h"
@@ -18,27 +19,96 @@
 #include "pico/scanvideo/composable_scanline.h"
 #include "pico/sync.h"
 #include "hardware/vreg.h"
+#include "hardware/clocks.h"
+#include "hardware/structs/systick.h"
+#include "hardware/regs/m0plus.h"
+#include "hardware/watchdog.h"
 #include "pico/stdio.h"
 #include "osd.h"
-#include "hardware/i2c.h"
+#include "capture.h"
+#include "frame_layout.h"
+#include "framestore.h"
+#include "render.h"
+#include "linestats.h"
+#include "controller.h"
+#include "joypad.h"
+#include "inputlog.h"
+#include "turbo.h"
 
 #define SDA_PIN     12
 #define SCL_PIN     13
-#define I2C_ADDRESS 0x52
-i2c_inst_t* i2cHandle = i2c0;
 
-#define VGA_MODE vga_mode_640x480_60
-#define MIN_RUN 3
+// Original NES pad, for CONTROLLER_NES_PAD builds.  Set these to match your
+// wiring; by default it takes the I2C controller's two lines plus GPIO 11.
+#ifndef NES_LATCH_PIN
+#define NES_LATCH_PIN   SDA_PIN
+#endif
+#ifndef NES_CLOCK_PIN
+#define NES_CLOCK_PIN   SCL_PIN
+#endif
+#ifndef NES_DATA_PIN
+#define NES_DATA_PIN    11
+#endif
+
+// 800x600 on a 300MHz / 8 pixel clock: VESA 800x600@56 line and frame
+// totals, which lands at 58.6Hz
+static const scanvideo_timing_t vga_timing_800x600_58 =
+{
+    .clock_freq = 37500000,
+
+    .h_active = 800,
+    .v_active = 600,
+
+    .h_front_porch = 24,
+    .h_pulse = 72,
+    .h_total = 1024,
+    .h_sync_polarity = 0,
+
+    .v_front_porch = 1,
+    .v_pulse = 2,
+    .v_total = 625,
+    .v_sync_polarity = 0,
+
+    .enable_clock = 0,
+    .clock_polarity = 0,
+
+    .enable_den = 0
+};
+
+static const scanvideo_mode_t vga_mode_800x600_58 =
+{
+    .default_timing = &vga_timing_800x600_58,
+    .pio_program = &video_24mhz_composable,
+    .width = 800,
+    .height = 600,
+    .xscale = 1,
+    .yscale = 1,
+};
+
+// scanvideo mode for each render mode
+static const scanvideo_mode_t* const vga_modes[RENDER_MODE_COUNT] =
+{
+    [RENDER_MODE_640X480_3X] = &vga_mode_640x480_60,
+    [RENDER_MODE_800X600_4X] = &vga_mode_800x600_58,
+    [RENDER_MODE_640X480_2X] = &vga_mode_640x480_60,
+};
+
+// scanvideo can't be torn down and set up again, so a mode change reboots
+// through the watchdog.  Scratch registers 1-3 carry the new mode and every
+// menu setting across it, a byte each; 4-7 belong to the boot ROM.
+#define MODE_SCRATCH_MAGIC      (0x4D4F4445)    // 'MODE'
 
 #define ONBOARD_LED_PIN         25
 
 // GAMEBOY VIDEO INPUT (From level shifter)
+// Must stay consecutive, DATA_0 first - see lcd_capture.pio
 #define VSYNC_PIN               18
 #define HSYNC_PIN               17
 #define PIXEL_CLOCK_PIN         16
 #define DATA_1_PIN              15
 #define DATA_0_PIN              14
 
+// P14 and P15 must stay consecutive, P10-P13 within 7 pins - see joypad.pio
 #define BUTTONS_DPAD_PIN        19      // P14
 #define BUTTONS_OTHER_PIN       20      // P15
 #define BUTTONS_LEFT_B_PIN      26      // P11
@@ -48,333 +118,143 @@ i2c_inst_t* i2cHandle = i2c0;
 
 #define GAMEBOY_RESET_PIN       28
 
-#define PIXELS_X                (160)
-#define PIXELS_Y                (144)
-
-// Game area will be 480x432 
-#define PIXEL_SCALE             (3)
-#define BORDER_HORZ             (80)    
-#define BORDER_VERT             (24)
-
-#define PIXEL_COUNT             (PIXELS_X*PIXELS_Y)
+typedef enum
+{
+    OSD_LINE_COLOR_SCHEME = 0,
+    OSD_LINE_BORDER_COLOR,
+    OSD_LINE_EFFECTS,
+    OSD_LINE_FX_SCHEME,
+    OSD_LINE_OUTPUT_MODE,
+    OSD_LINE_OSD_STYLE,
+    OSD_LINE_POLL_RATE,
+    OSD_LINE_TURBO_A,
+    OSD_LINE_TURBO_B,
+    OSD_LINE_MACRO,
+    OSD_LINE_INPUT,
+    OSD_LINE_DIAGNOSTICS,
+    OSD_LINE_RESET_GAMEBOY,
+    OSD_LINE_EXIT,
+    OSD_LINE_COUNT
+} osd_line_t;
 
-#define RGB888_TO_RGB222(r, g, b) ((((b)>>6u)<<PICO_SCANVIDEO_PIXEL_BSHIFT)|(((g)>>6u)<<PICO_SCANVIDEO_PIXEL_GSHIFT)|(((r)>>6u)<<PICO_SCANVIDEO_PIXEL_RSHIFT))
+typedef enum
+{
+    DIAG_LINE_AVG = 0,
+    DIAG_LINE_P99,
+    DIAG_LINE_MAX,
+    DIAG_LINE_BUDGET,
+    DIAG_LINE_LATE,
+    DIAG_LINE_CACHE,
+    DIAG_LINE_CORES,
+    DIAG_LINE_BACK,
+    DIAG_LINE_COUNT
+} diag_line_t;
 
-static uint8_t border_colors[] = {
-    RGB888_TO_RGB222(0x00, 0x00, 0x00), // BLACK
-    RGB888_TO_RGB222(0x00, 0x00, 0xFF), // BLUE
-    RGB888_TO_RGB222(0xFF, 0xFF, 0xFF), // WHITE
-    RGB888_TO_RGB222(0x80, 0x80, 0x80), // LIGHT GREY
-    RGB888_TO_RGB222(0x40, 0x40, 0x40), // DARK GREY
-    RGB888_TO_RGB222(0xFF, 0x00, 0x00), // RED
-    RGB888_TO_RGB222(0x00, 0xFF, 0x00), // GREEN
-    RGB888_TO_RGB222(0xFF, 0xFF, 0x00), // YELLOW
-    RGB888_TO_RGB222(0xFF, 0x00, 0xFF), // PURPLE
-};
+typedef enum
+{
+    DIAG_LINE_FRAMES = 0,
+    DIAG_LINE_SHORT,
+    DIAG_LINE_LONG,
+    DIAG_LINE_RESYNCS,
+    DIAG_LINE_LINES,
+    DIAG_LINE_PERIOD
+} diag_capture_line_t;
 
 typedef enum
 {
-    BUTTON_A = 0,
-    BUTTON_B,
-    BUTTON_SELECT,
-    BUTTON_START,
-    BUTTON_UP,
-    BUTTON_DOWN,
-    BUTTON_LEFT,
-    BUTTON_RIGHT,
-    BUTTON_HOME,
-    BUTTON_COUNT
-} controller_button_t;
+    DIAG_LINE_SYNC = 0,
+    DIAG_LINE_READ_PERIOD,
+    DIAG_LINE_AGE_P50,
+    DIAG_LINE_AGE_P99,
+    DIAG_LINE_AGE_MAX,
+    DIAG_LINE_PAD,
+    DIAG_LINE_BUS_ERRORS
+} diag_input_line_t;
 
 typedef enum
 {
-    VIDEO_EFFECT_NONE = 0,
-    VIDEO_EFFECT_PIXEL_EFFECT,
-    VIDEO_EFFECT_SCANLINES,
-    VIDEO_EFFECT_COUNT
-} video_effect_t;
+    DIAG_VIEW_RENDER = 0,
+    DIAG_VIEW_CAPTURE,
+    DIAG_VIEW_INPUT,
+    DIAG_VIEW_COUNT
+} diag_view_t;
 
 typedef enum
 {
-    OSD_LINE_COLOR_SCHEME = 0,
-    OSD_LINE_BORDER_COLOR,
-    OSD_LINE_EFFECTS,
-    OSD_LINE_FX_SCHEME,
-    OSD_LINE_RESET_GAMEBOY,
-    OSD_LINE_EXIT,
-    OSD_LINE_COUNT
-} osd_line_t;
+    OSD_PAGE_MENU = 0,
+    OSD_PAGE_DIAGNOSTICS
+} osd_page_t;
+
+// Diagnostics page refresh interval
+#define DIAG_REFRESH_MS         (500)
+
+// Controller poll rates offered in the menu
+static const int poll_rates[] = { 60, 120, 240, CONTROLLER_MAX_POLL_HZ };
 
 static semaphore_t video_initted;
-static volatile uint8_t button_states[BUTTON_COUNT];
+static uint8_t button_states[BUTTON_COUNT];         // 0 while held, for the menu
 static uint8_t button_states_previous[BUTTON_COUNT];
-static volatile uint8_t buttons_state = 0xFF;
-static int scheme_offset = 0;
-static int scanline_color_offset = 0;
-static int video_effect = VIDEO_EFFECT_NONE;
-
-static uint8_t framebuffer[PIXEL_COUNT];
-static uint8_t osd_framebuffer[OSD_HEIGHT*OSD_WIDTH] = {0};
-
-// map gb pixel to screen pixel
-static uint8_t indexes_x[PIXELS_X*PIXEL_SCALE];
-static uint8_t indexes_y[PIXELS_Y*PIXEL_SCALE];
-
-static int8_t border_color_index = 0;
-static uint16_t scanline_color = RGB888_TO_RGB222(0x00, 0x00, 0x00);
-
-static uint16_t colors[] = {
-    // Black and white
-    RGB888_TO_RGB222(0xF7, 0xF3, 0xF7),
-    RGB888_TO_RGB222(0xB5, 0xB2, 0xB5),
-    RGB888_TO_RGB222(0x4E, 0x4C, 0x4E),
-    RGB888_TO_RGB222(0x00, 0x00, 0x00),
-
-    // Inverted
-    RGB888_TO_RGB222(0x00, 0x00, 0x00),
-    RGB888_TO_RGB222(0x4E, 0x4C, 0x4E),
-    RGB888_TO_RGB222(0xB5, 0xB2, 0xB5),
-    RGB888_TO_RGB222(0xF7, 0xF3, 0xF7),
-
-    // DMG
-    RGB888_TO_RGB222(0x7B, 0x82, 0x10),
-    RGB888_TO_RGB222(0x5A, 0x79, 0x42),
-    RGB888_TO_RGB222(0x39, 0x59, 0x4A),
-    RGB888_TO_RGB222(0x29, 0x41, 0x39),
-
-    // Game Boy Pocket
-    RGB888_TO_RGB222(0xC6, 0xCB, 0xA5),
-    RGB888_TO_RGB222(0x8C, 0x92, 0x6B),
-    RGB888_TO_RGB222(0x4A, 0x51, 0x39),
-    RGB888_TO_RGB222(0x18, 0x18, 0x18),
-
-    // Game Boy Light
-    RGB888_TO_RGB222(0x00, 0xB2, 0x84),
-    RGB888_TO_RGB222(0x8C, 0x92, 0x6B),
-    RGB888_TO_RGB222(0x00, 0x69, 0x4A),
-    RGB888_TO_RGB222(0x00, 0x51, 0x39),
-
-    // SGB 1A
-    RGB888_TO_RGB222(0xF7, 0xE3, 0xC6),
-    RGB888_TO_RGB222(0xD6, 0x92, 0x4A),
-    RGB888_TO_RGB222(0xA5, 0x28, 0x21),
-    RGB888_TO_RGB222(0x31, 0x18, 0x52),
-
-    // SGB 2A
-    RGB888_TO_RGB222(0xEF, 0xC3, 0x9C),
-    RGB888_TO_RGB222(0xBD, 0x8A, 0x4A),
-    RGB888_TO_RGB222(0x29, 0x79, 0x00),
-    RGB888_TO_RGB222(0x00, 0x00, 0x00),
-
-    // SGB 3A
-    RGB888_TO_RGB222(0xF7, 0xCB, 0x94),
-    RGB888_TO_RGB222(0x73, 0xBA, 0xBD),
-    RGB888_TO_RGB222(0xF7, 0x61, 0x29),
-    RGB888_TO_RGB222(0x31, 0x49, 0x63),
-
-    // SGB 4A
-    RGB888_TO_RGB222(0xEF, 0xA2, 0x6B),
-    RGB888_TO_RGB222(0x7B, 0xA2, 0xF7),
-    RGB888_TO_RGB222(0xCE, 0x00, 0xCE),
-    RGB888_TO_RGB222(0x00, 0x00, 0x7B),
-
-    // SGB 1B
-    RGB888_TO_RGB222(0xD6, 0xD3, 0xBD),
-    RGB888_TO_RGB222(0xC6, 0xAA, 0x73),
-    RGB888_TO_RGB222(0xAD, 0x51, 0x10),
-    RGB888_TO_RGB222(0x00, 0x00, 0x00),
-
-    // SGB 2B
-    RGB888_TO_RGB222(0xF7, 0xF3, 0xF7),
-    RGB888_TO_RGB222(0xF7, 0xE3, 0x52),
-    RGB888_TO_RGB222(0xF7, 0x30, 0x00),
-    RGB888_TO_RGB222(0x52, 0x00, 0x5A),
-
-    // SGB 3B
-    RGB888_TO_RGB222(0xD6, 0xD3, 0xBD),
-    RGB888_TO_RGB222(0xDE, 0x82, 0x21),
-    RGB888_TO_RGB222(0x00, 0x51, 0x00),
-    RGB888_TO_RGB222(0x00, 0x10, 0x10),
-
-    // SGB 4B
-    RGB888_TO_RGB222(0xEF, 0xE3, 0xEF),
-    RGB888_TO_RGB222(0xE7, 0x9A, 0x63),
-    RGB888_TO_RGB222(0x42, 0x79, 0x39),
-    RGB888_TO_RGB222(0x18, 0x08, 0x08),
-
-    // SGB 1C
-    RGB888_TO_RGB222(0xF7, 0xBA, 0xF7),
-    RGB888_TO_RGB222(0xE7, 0x92, 0x52),
-    RGB888_TO_RGB222(0x94, 0x38, 0x63),
-    RGB888_TO_RGB222(0x39, 0x38, 0x94),
-
-    // SGB 2C
-    RGB888_TO_RGB222(0xF7, 0xF3, 0xF7),
-    RGB888_TO_RGB222(0xE7, 0x8A, 0x8C),
-    RGB888_TO_RGB222(0x7B, 0x30, 0xE7),
-    RGB888_TO_RGB222(0x29, 0x28, 0x94),
-
-    // SGB 3C
-    RGB888_TO_RGB222(0xDE, 0xA2, 0xC6),
-    RGB888_TO_RGB222(0xF7, 0xF3, 0x7B),
-    RGB888_TO_RGB222(0x00, 0xB2, 0xF7),
-    RGB888_TO_RGB222(0x21, 0x20, 0x5A),
-
-    // SGB 4C
-    RGB888_TO_RGB222(0xF7, 0xDB, 0xDE),
-    RGB888_TO_RGB222(0xF7, 0xF3, 0x7B),
-    RGB888_TO_RGB222(0x94, 0x9A, 0xDE),
-    RGB888_TO_RGB222(0x08, 0x00, 0x00),
-
-    // SGB 1D
-    RGB888_TO_RGB222(0xF7, 0xF3, 0xA5),
-    RGB888_TO_RGB222(0xBD, 0x82, 0x4A),
-    RGB888_TO_RGB222(0xF7, 0x00, 0x00),
-    RGB888_TO_RGB222(0x52, 0x18, 0x00),
-
-    // SGB 2D
-    RGB888_TO_RGB222(0xF7, 0xF3, 0x9C),
-    RGB888_TO_RGB222(0x00, 0xF3, 0x00),
-    RGB888_TO_RGB222(0xF7, 0x30, 0x00),
-    RGB888_TO_RGB222(0x00, 0x00, 0x52),
-
-    // SGB 3D
-    RGB888_TO_RGB222(0xEF, 0xF3, 0xB5),
-    RGB888_TO_RGB222(0xDE, 0xA2, 0x7B),
-    RGB888_TO_RGB222(0x96, 0xAD, 0x52),
-    RGB888_TO_RGB222(0x00, 0x00, 0x00),
-
-    // SGB 4D
-    RGB888_TO_RGB222(0xF7, 0xF3, 0xB5),
-    RGB888_TO_RGB222(0x94, 0xC3, 0xC6),
-    RGB888_TO_RGB222(0x4A, 0x69, 0x7B),
-    RGB888_TO_RGB222(0x08, 0x20, 0x4A),
-
-    // SGB 1E
-    RGB888_TO_RGB222(0xF7, 0xD3, 0xAD),
-    RGB888_TO_RGB222(0x7B, 0xBA, 0x7B),
-    RGB888_TO_RGB222(0x6B, 0x8A, 0x42),
-    RGB888_TO_RGB222(0x5A, 0x38, 0x21),
-
-    // SGB 2E
-    RGB888_TO_RGB222(0xF7, 0xC3, 0x84),
-    RGB888_TO_RGB222(0x94, 0xAA, 0xDE),
-    RGB888_TO_RGB222(0x29, 0x10, 0x63),
-    RGB888_TO_RGB222(0x10, 0x08, 0x10),
-
-    // SGB 3E
-    RGB888_TO_RGB222(0xF7, 0xF3, 0xBD),
-    RGB888_TO_RGB222(0xDE, 0xAA, 0x6B),
-    RGB888_TO_RGB222(0xAD, 0x79, 0x21),
-    RGB888_TO_RGB222(0x52, 0x49, 0x73),
-
-    // SGB 4E
-    RGB888_TO_RGB222(0xF7, 0xD3, 0xA5),
-    RGB888_TO_RGB222(0xDE, 0xA2, 0x7B),
-    RGB888_TO_RGB222(0x7B, 0x59, 0x8C),
-    RGB888_TO_RGB222(0x00, 0x20, 0x31),
-
-    // SGB 1F
-    RGB888_TO_RGB222(0xD6, 0xE3, 0xF7),
-    RGB888_TO_RGB222(0xDE, 0x8A, 0x52),
-    RGB888_TO_RGB222(0xA5, 0x00, 0x00),
-    RGB888_TO_RGB222(0x00, 0x41, 0x10),
-
-    // SGB 2F
-    RGB888_TO_RGB222(0xCE, 0xF3, 0xF7),
-    RGB888_TO_RGB222(0xF7, 0x92, 0x52),
-    RGB888_TO_RGB222(0x9C, 0x00, 0x00),
-    RGB888_TO_RGB222(0x18, 0x00, 0x00),
-
-    // SGB 3F
-    RGB888_TO_RGB222(0x7B, 0x79, 0xC6),
-    RGB888_TO_RGB222(0xF7, 0x69, 0xF7),
-    RGB888_TO_RGB222(0xF7, 0xCB, 0x00),
-    RGB888_TO_RGB222(0x42, 0x41, 0x42),
-
-    // SGB 4F
-    RGB888_TO_RGB222(0xB5, 0xCB, 0xCE),
-    RGB888_TO_RGB222(0xD6, 0x82, 0xD6),
-    RGB888_TO_RGB222(0x84, 0x00, 0x9C),
-    RGB888_TO_RGB222(0x39, 0x00, 0x00),
-
-    // SGB 1G
-    RGB888_TO_RGB222(0x00, 0x00, 0x52),
-    RGB888_TO_RGB222(0x00, 0x9A, 0xE7),
-    RGB888_TO_RGB222(0x7B, 0x79, 0x00),
-    RGB888_TO_RGB222(0xF7, 0xF3, 0x5A),
-
-    // SGB 2G
-    RGB888_TO_RGB222(0x6B, 0xB2, 0x39),
-    RGB888_TO_RGB222(0xDE, 0x51, 0x42),
-    RGB888_TO_RGB222(0xDE, 0xB2, 0x84),
-    RGB888_TO_RGB222(0x00, 0x18, 0x00),
-
-    // SGB 3G
-    RGB888_TO_RGB222(0x63, 0xD3, 0x52),
-    RGB888_TO_RGB222(0xF7, 0xF3, 0xF7),
-    RGB888_TO_RGB222(0xC6, 0x30, 0x39),
-    RGB888_TO_RGB222(0x39, 0x00, 0x00),
-
-    // SGB 4G
-    RGB888_TO_RGB222(0xAD, 0xDB, 0x18),
-    RGB888_TO_RGB222(0xB5, 0x20, 0x5A),
-    RGB888_TO_RGB222(0x29, 0x10, 0x00),
-    RGB888_TO_RGB222(0x00, 0x82, 0x63),
-
-    // SGB 1H
-    RGB888_TO_RGB222(0xF7, 0xE3, 0xDE),
-    RGB888_TO_RGB222(0xF7, 0xB2, 0x8C),
-    RGB888_TO_RGB222(0x84, 0x41, 0x00),
-    RGB888_TO_RGB222(0x31, 0x18, 0x00),
-
-    // SGB 2H
-    RGB888_TO_RGB222(0xF7, 0xF3, 0xF7),
-    RGB888_TO_RGB222(0xB5, 0xB2, 0xB5),
-    RGB888_TO_RGB222(0x73, 0x71, 0x73),
-    RGB888_TO_RGB222(0x00, 0x00, 0x00),
-
-    // SGB 3H
-    RGB888_TO_RGB222(0xDE, 0xF3, 0x9C),
-    RGB888_TO_RGB222(0x7B, 0xC3, 0x39),
-    RGB888_TO_RGB222(0x4A, 0x8A, 0x18),
-    RGB888_TO_RGB222(0x08, 0x18, 0x00),
-
-    // SGB 4H
-    RGB888_TO_RGB222(0xF7, 0xF3, 0xC6),
-    RGB888_TO_RGB222(0xB5, 0xBA, 0x5A),
-    RGB888_TO_RGB222(0x84, 0x8A, 0x42),
-    RGB888_TO_RGB222(0x42, 0x51, 0x29)
-};
+static repeating_timer_t controller_timer;
+static osd_page_t osd_page = OSD_PAGE_MENU;
+static uint32_t diag_refresh_ms = 0;
+static int diag_view = DIAG_VIEW_RENDER;
+static const scanvideo_mode_t* vga_mode;
+static render_mode_t pending_mode;
+static inputlog_mode_t pending_input = INPUTLOG_LIVE;
 
 static void core1_func(void);
 static void render_scanline(scanvideo_scanline_buffer_t *buffer);
+static void render_idle_scanlines(void);
+static void core0_idle(void);
+static void idle_ms(uint32_t ms);
 static void initialize_gpio(void);
-static void video_stuff(void);
-static void nes_classic_controller(void);
-static void gpio_callback(uint gpio, uint32_t events);
-static void change_scheme_offset(int direction);
-static void change_border_color_index(int direction);
-static void change_video_effect(int increment);
-static void change_scanline_color(int increment);
+static bool controller_tick(repeating_timer_t* timer);
+static void read_controller(void);
 static void command_check(void);
 static bool button_is_pressed(controller_button_t button);
 static bool button_was_released(controller_button_t button);
 static long map(long x, long in_min, long in_max, long out_min, long out_max);
-static void set_indexes(void);
+#if RENDER_BENCHMARK
+static void benchmark_scanline(void);
+#endif
 static void update_osd(void);
+static void update_diagnostics(void);
+static uint32_t line_budget_cycles(void);
+static void change_poll_rate(int direction);
+static void apply_input_mode(inputlog_mode_t mode);
+#if INPUTLOG_EXPORT
+static void export_recording(void);
+static void export_write(const uint8_t* data, size_t length, void* context);
+#endif
 static void gameboy_reset(void);
+static render_mode_t boot_mode(void);
+static void restore_settings(void);
+static void apply_mode(render_mode_t mode);
 
-int32_t single_solid_line(uint32_t *buf, size_t buf_length, uint16_t color);
-int32_t single_scanline(uint32_t *buf, size_t buf_length, uint8_t mapped_y);
 
 int main(void) 
 {
+    // Drive the Game Boy reset line high before anything else: until now
+    // the pad's reset default, a pull-down, has held the Game Boy in reset
+    gpio_init(GAMEBOY_RESET_PIN);
+    gpio_put(GAMEBOY_RESET_PIN, 1);
+    gpio_set_dir(GAMEBOY_RESET_PIN, GPIO_OUT);
+
     hw_set_bits(&vreg_and_chip_reset_hw->vreg, VREG_AND_CHIP_RESET_VREG_VSEL_BITS);
     sleep_ms(10);
 
     set_sys_clock_khz(300000, true);
 
+    pending_mode = boot_mode();
+    vga_mode = vga_modes[pending_mode];
+
+    FRAMESTORE_init();
+    LINESTATS_init(vga_mode->height);
+    OSD_init();
+    RENDER_init(pending_mode);
+    restore_settings();
+    INPUTLOG_init();
+
     // Create a semaphore to be posted when video init is complete.
     sem_init(&video_initted, 0, 1);
 
@@ -386,6 +266,8 @@ int main(void)
 
     initialize_gpio();
 
+    CAPTURE_init(DATA_0_PIN);
+
     // Clear all button states
     for (int i = 0; i < BUTTON_COUNT; i++) 
     {
@@ -393,18 +275,34 @@ int main(void)
         button_states_previous[i] = 1;
     }
 
-    set_indexes();
+#if INPUTLOG_EXPORT && !RENDER_BENCHMARK
+    stdio_init_all();
+#endif
+
+#if RENDER_BENCHMARK
+    stdio_init_all();
+    sleep_ms(3000);     // give the USB serial port time to come up
 
-    change_scanline_color(0);
+    while (RENDER_get_display_frame() == NULL)
+    {
+        tight_loop_contents();
+    }
+    benchmark_scanline();
+#endif
     
-    OSD_init(osd_framebuffer);
     update_osd();
     
     while (true) 
     {
-        video_stuff();
-        nes_classic_controller();
+        core0_idle();
+        read_controller();
         command_check();
+
+        if (OSD_is_enabled() && osd_page == OSD_PAGE_DIAGNOSTICS
+            && to_ms_since_boot(get_absolute_time()) - diag_refresh_ms >= DIAG_REFRESH_MS)
+        {
+            update_diagnostics();
+        }
     }
 }
 
@@ -413,198 +311,107 @@ static long map(long x, long in_min, long in_max, long out_min, long out_max)
   return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
 }
 
-static void video_stuff(void)
+#if RENDER_BENCHMARK
+static void benchmark_scanline(void)
 {
-    static bool vsync_reset;
-    static bool vsync;
-
-    uint8_t *p = framebuffer; 
-
-    while (gpio_get(VSYNC_PIN) == 0);
+    static uint32_t buf[PICO_SCANVIDEO_MAX_SCANLINE_BUFFER_WORDS];
+    uint32_t reference_cycles = 0;
+    uint32_t run_cycles = 0;
 
-    vsync_reset = false;
+    // SysTick as a free-running 24-bit down counter at the CPU clock
+    systick_hw->rvr = 0x00FFFFFF;
+    systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
 
-    for (int y = 0; y < PIXELS_Y; y++) {
-        while (gpio_get(HSYNC_PIN) == 0);
-        while (gpio_get(HSYNC_PIN) == 1);
-
-        *p++ = (gpio_get(DATA_0_PIN) << 1) + gpio_get(DATA_1_PIN);
-        
-        for (int x = 0; x < (PIXELS_X-1); x++) {
-            while (gpio_get(PIXEL_CLOCK_PIN) == 0);
-            while (gpio_get(PIXEL_CLOCK_PIN) == 1);
-
-            *p++ = (gpio_get(DATA_0_PIN) << 1) + gpio_get(DATA_1_PIN);
-        }
+    for (int y = 0; y < PIXELS_Y; y++)
+    {
+        uint32_t start = systick_hw->cvr;
+        RENDER_reference_line(buf, count_of(buf), y);
+        reference_cycles += (start - systick_hw->cvr) & 0x00FFFFFF;
 
-        vsync = gpio_get(VSYNC_PIN);
-        if (!vsync) { vsync_reset = true; }
-        if (vsync && vsync_reset) { break; }
+        start = systick_hw->cvr;
+        RENDER_compose_line(buf, count_of(buf), y);
+        run_cycles += (start - systick_hw->cvr) & 0x00FFFFFF;
     }
+
+    printf("single_scanline: per-pixel %lu cycles/line, line kernels %lu cycles/line\n",
+           (unsigned long)(reference_cycles / PIXELS_Y), (unsigned long)(run_cycles / PIXELS_Y));
 }
+#endif
 
-int32_t single_scanline(uint32_t *buf, size_t buf_length, uint8_t mapped_y)
+static void render_scanline(scanvideo_scanline_buffer_t *dest) 
 {
-    uint16_t* p16 = (uint16_t *) buf;
-    uint16_t* first_pixel;
-
-    // LEFT BORDER
-    *p16++ = COMPOSABLE_COLOR_RUN;
-    *p16++ = border_colors[border_color_index];
-    *p16++ = BORDER_HORZ - MIN_RUN - 1;
+    int line_num = scanvideo_scanline_number(dest->scanline_id);
+    uint16_t frame_num = scanvideo_frame_number(dest->scanline_id);
 
-    // PLAY AREA
-    *p16++ = COMPOSABLE_RAW_RUN;
-    first_pixel = p16;
-    *p16++ = RGB888_TO_RGB222(0x00, 0xFF, 0x00); // replaced later - first pixel
-    *p16++ = PIXELS_X*PIXEL_SCALE - MIN_RUN;
-    
-    uint8_t *pbuff = &framebuffer[mapped_y * PIXELS_X];
-
-    int pos = 0;
-    int x,i;
-    uint16_t color = 0;
-    uint8_t osd_start_x = (PIXELS_X - OSD_get_width())/2;
-    uint8_t osd_end_x = osd_start_x + OSD_get_width();
-    uint8_t osd_start_y = (PIXELS_Y - OSD_get_height())/2;
-    uint8_t osd_end_y = osd_start_y + OSD_get_height();
-    uint osd_char_index = 0;
-    uint8_t pixels = 0;
-    bool in_osd = false;
-    int osd_pos = 0;
-    bool osd_row = OSD_is_enabled() & (mapped_y >= osd_start_y) & (mapped_y < osd_end_y);
-
-    uint16_t nnn = (mapped_y - osd_start_y) * OSD_WIDTH;
-    for (x = 0; x < PIXELS_X; x++)
-    {
-        if (osd_row && (osd_pos >= 0))
-        {
-            in_osd = x >= osd_start_x && x < osd_end_x;
-        }
+    dest->data_used = RENDER_scanline(dest->data, dest->data_max, line_num, frame_num);
+    dest->status = SCANLINE_OK;
+}
 
-        for (i = 0; i < PIXEL_SCALE; i++)
-        {
-            if (x == 0 && i == 0)
-            {
-                *first_pixel = colors[*(pbuff) + scheme_offset];
-            }
-            else
-            {
-                if (in_osd )
-                {
-                    color = (uint16_t)(osd_framebuffer[nnn + osd_pos]);
-                }
-                else
-                {
-                    // if pixel-effect enabled & 3rd pixel...
-                    if ((video_effect == VIDEO_EFFECT_PIXEL_EFFECT) && i == 2)
-                    {
-                        color = scanline_color;
-                    }
-                    else
-                    {
-                        color = colors[*(pbuff) + (uint8_t)scheme_offset]; 
-                    }
-                }
 
-                *p16++ = color; 
-            }
-        }
-        if (in_osd)
-        {
-            osd_pos++;
-        }
+// Core 0 side of scanline generation: takes whatever lines scanvideo has
+// ready without waiting, so core 1 gets the headroom back whenever core 0
+// has nothing else to do.  Line timing stays with core 1.
+static void render_idle_scanlines(void)
+{
+    scanvideo_scanline_buffer_t *scanline_buffer;
 
-        pbuff++;
+    while ((scanline_buffer = scanvideo_begin_scanline_generation(false)) != NULL)
+    {
+        LINESTATS_taken(scanvideo_frame_number(scanline_buffer->scanline_id),
+                        scanvideo_scanline_number(scanline_buffer->scanline_id));
+        render_scanline(scanline_buffer);
+        scanvideo_end_scanline_generation(scanline_buffer);
     }
-   
-    // RIGHT BORDER
-    *p16++ = COMPOSABLE_COLOR_RUN;
-    *p16++ = border_colors[border_color_index]; 
-    *p16++ = BORDER_HORZ - MIN_RUN;
-
-    // black pixel to end line
-    *p16++ = COMPOSABLE_RAW_1P;
-    *p16++ = 0;
-
-    *p16++ = COMPOSABLE_EOL_ALIGN;
-
-    return ((uint32_t *) p16) - buf;
 }
 
-int32_t single_solid_line(uint32_t *buf, size_t buf_length, uint16_t color)
+// Spare core 0 time: scanlines first, then a slice of the Scale3x pass
+static void core0_idle(void)
 {
-    uint16_t *p16 = (uint16_t *) buf;
-
-    // LEFT BORDER
-    *p16++ = COMPOSABLE_COLOR_RUN;
-    *p16++ = border_colors[border_color_index]; 
-    *p16++ = BORDER_HORZ - MIN_RUN - 1;
-
-    *p16++ = COMPOSABLE_COLOR_RUN;
-    *p16++ = color; 
-    *p16++ = PIXELS_X*PIXEL_SCALE - MIN_RUN;
-
-    //RIGHT BORDER
-    *p16++ = COMPOSABLE_COLOR_RUN;
-    *p16++ = border_colors[border_color_index]; 
-    *p16++ = BORDER_HORZ - MIN_RUN;
-
-    // black pixel to end line
-    *p16++ = COMPOSABLE_RAW_1P;
-    *p16++ = 0;
-
-    *p16++ = COMPOSABLE_EOL_ALIGN;
-    
-    return ((uint32_t *) p16) - buf;
+    render_idle_scanlines();
+    RENDER_smooth_step();
 }
 
-static void render_scanline(scanvideo_scanline_buffer_t *dest) 
+// sleep_ms() that does core 0's idle work in the meantime
+static void idle_ms(uint32_t ms)
 {
-    uint32_t *buf = dest->data;
-    size_t buf_length = dest->data_max;
-    int line_num = scanvideo_scanline_number(dest->scanline_id);
-       
-    if (line_num < (BORDER_VERT) || line_num >= (PIXELS_Y*PIXEL_SCALE + BORDER_VERT))
+    absolute_time_t until = make_timeout_time_ms(ms);
+
+    while (!time_reached(until))
     {
-         dest->data_used = single_solid_line(buf, buf_length, border_colors[border_color_index]);
+        core0_idle();
     }
-    else
-    {
-        if ((video_effect == VIDEO_EFFECT_PIXEL_EFFECT || video_effect == VIDEO_EFFECT_SCANLINES)
-            &&  line_num % PIXEL_SCALE == 0)
-        {
-            dest->data_used = single_solid_line(buf, buf_length, scanline_color);
-        }
-        else
-        {
-            uint8_t mapped_y = indexes_y[line_num-BORDER_VERT];
-            dest->data_used = single_scanline(buf, buf_length, mapped_y);
-        }
-    }
-
-    dest->status = SCANLINE_OK;
 }
 
-
 static void core1_func(void) 
 {
     
-    hard_assert(VGA_MODE.width + 4 <= PICO_SCANVIDEO_MAX_SCANLINE_BUFFER_WORDS * 2);    
+    hard_assert(vga_mode->width + 4 <= PICO_SCANVIDEO_MAX_SCANLINE_BUFFER_WORDS * 2);    
 
     // Initialize video and interrupts on core 1.
-    scanvideo_setup(&VGA_MODE);
+    scanvideo_setup(vga_mode);
     scanvideo_timing_enable(true);
     sem_release(&video_initted);
 
-    gpio_set_irq_enabled_with_callback(BUTTONS_DPAD_PIN, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true, &gpio_callback);
-    gpio_set_irq_enabled_with_callback(BUTTONS_OTHER_PIN, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true, &gpio_callback);
+    // SysTick as a free-running 24-bit down counter at the CPU clock, for line timing
+    systick_hw->rvr = 0x00FFFFFF;
+    systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
 
     while (true) 
     {
         scanvideo_scanline_buffer_t *scanline_buffer = scanvideo_begin_scanline_generation(true);
+        uint32_t scanline_id = scanline_buffer->scanline_id;
+        LINESTATS_taken(scanvideo_frame_number(scanline_id), scanvideo_scanline_number(scanline_id));
+
+        uint32_t start = systick_hw->cvr;
         render_scanline(scanline_buffer);
+        LINESTATS_record((start - systick_hw->cvr) & 0x00FFFFFF);
+
         scanvideo_end_scanline_generation(scanline_buffer);
+
+        if (scanvideo_scanline_number(scanline_id) == vga_mode->height - 1)
+        {
+            LINESTATS_end_frame();
+        }
     }
 }
 
@@ -616,10 +423,6 @@ static void initialize_gpio(void)
     gpio_put(ONBOARD_LED_PIN, 0);
 
     // Gameboy Reset
-    gpio_init(GAMEBOY_RESET_PIN);
-    gpio_set_dir(GAMEBOY_RESET_PIN, GPIO_OUT);
-    gpio_put(GAMEBOY_RESET_PIN, 1);
-
     // Gameboy video signal inputs
     gpio_init(VSYNC_PIN);
     gpio_init(PIXEL_CLOCK_PIN);
@@ -630,197 +433,58 @@ static void initialize_gpio(void)
     // UART, for testing
     //stdio_init_all();
 
-    // //Initialize I2C port at 400 kHz
-    i2c_init(i2cHandle, 400 * 1000);
-
-    // Initialize I2C pins
-    gpio_set_function(SCL_PIN, GPIO_FUNC_I2C);
-    gpio_set_function(SDA_PIN, GPIO_FUNC_I2C);
-    gpio_pull_up(SCL_PIN);
-    gpio_pull_up(SDA_PIN);
-
-    gpio_init(BUTTONS_RIGHT_A_PIN);
-    gpio_set_dir(BUTTONS_RIGHT_A_PIN, GPIO_OUT);
-    gpio_put(BUTTONS_RIGHT_A_PIN, 1);
-
-    gpio_init(BUTTONS_LEFT_B_PIN);
-    gpio_set_dir(BUTTONS_LEFT_B_PIN, GPIO_OUT);
-    gpio_put(BUTTONS_LEFT_B_PIN, 1);
-
-    gpio_init(BUTTONS_UP_SELECT_PIN);
-    gpio_set_dir(BUTTONS_UP_SELECT_PIN, GPIO_OUT);
-    gpio_put(BUTTONS_UP_SELECT_PIN, 1);
-
-    gpio_init(BUTTONS_DOWN_START_PIN);
-    gpio_set_dir(BUTTONS_DOWN_START_PIN, GPIO_OUT);
-    gpio_put(BUTTONS_DOWN_START_PIN, 1);
-
+    // Joypad matrix: P10-P13 are driven by PIO, which watches P14/P15 itself.
+    // Its read interrupts, like the controller timer, stay on this core.
+    static const uint8_t joypad_lines[4] =
+    {
+        BUTTONS_RIGHT_A_PIN, BUTTONS_LEFT_B_PIN, BUTTONS_UP_SELECT_PIN, BUTTONS_DOWN_START_PIN
+    };
     gpio_init(BUTTONS_DPAD_PIN);
     gpio_set_dir(BUTTONS_DPAD_PIN, GPIO_IN);
-
     gpio_init(BUTTONS_OTHER_PIN);
     gpio_set_dir(BUTTONS_OTHER_PIN, GPIO_IN);
-}
-
-static void nes_classic_controller(void)
-{
-    static uint32_t last_micros = 0;
-    uint32_t current_micros = time_us_32();
-
-    if (current_micros - last_micros < 20000)
-        return;
-    
-    static bool initialized = false;
-    static uint8_t i2c_buffer[16] = {0};
-
-    if (!initialized)
+    JOYPAD_init(BUTTONS_DPAD_PIN, joypad_lines);
+
+    // The NES pad's reader shares pio0 with scanvideo; without room there
+    // this falls back to the I2C controller
+    bool nes_pad = false;
+#if CONTROLLER_NES_PAD
+    nes_pad = CONTROLLER_init_nes_pad(time_us_32(), NES_LATCH_PIN, NES_CLOCK_PIN, NES_DATA_PIN);
+#endif
+    if (!nes_pad)
     {
-        sleep_ms(2000);
-
-        i2c_buffer[0] = 0xF0;
-        i2c_buffer[1] = 0x55;
-        (void)i2c_write_blocking(i2cHandle, I2C_ADDRESS, i2c_buffer, 2, false);
-        sleep_ms(10);
-
-        i2c_buffer[0] = 0xFB;
-        i2c_buffer[1] = 0x00;
-        (void)i2c_write_blocking(i2cHandle, I2C_ADDRESS, i2c_buffer, 2, false);
-        sleep_ms(20);
-
-        initialized = true;
-    }
-
-    last_micros = current_micros;
-
-    i2c_buffer[0] = 0x00;
-    (void)i2c_write_blocking(i2cHandle, I2C_ADDRESS, i2c_buffer, 1, false);   // false - finished with bus
-    sleep_ms(1);
-    int ret = i2c_read_blocking(i2cHandle, I2C_ADDRESS, i2c_buffer, 8, false);
-    if (ret < 0)
-    {
-        last_micros = time_us_32();
-        return;
+        // Controller I2C pins; the polling runs off a timer interrupt on this core
+        gpio_set_function(SCL_PIN, GPIO_FUNC_I2C);
+        gpio_set_function(SDA_PIN, GPIO_FUNC_I2C);
+        gpio_pull_up(SCL_PIN);
+        gpio_pull_up(SDA_PIN);
+        CONTROLLER_init(time_us_32());
     }
-        
-    bool valid = false;
-    uint8_t i;
-    for (i = 0; i < 8; i++)
-    {
-        if ((i < 4) && (i2c_buffer[i] != 0xFF))
-            valid = true;
-
-        if (valid)
-        {
-            if (i == 4)
-            {
-                button_states[BUTTON_START] = (~i2c_buffer[i] & (1<<2)) > 0 ? 0 : 1;
-                button_states[BUTTON_SELECT] = (~i2c_buffer[i] & (1<<4)) > 0 ? 0 : 1;
-                button_states[BUTTON_DOWN] = (~i2c_buffer[i] & (1<<6)) > 0 ? 0 : 1;
-                button_states[BUTTON_RIGHT] = (~i2c_buffer[i] & (1<<7)) > 0 ? 0 : 1;
-
-                button_states[BUTTON_HOME] = (~i2c_buffer[i] & (1<<3)) > 0 ? 0 : 1;
-            }
-            else if (i == 5)
-            {
-                button_states[BUTTON_UP] = (~i2c_buffer[i] & (1<<0)) > 0 ? 0 : 1;
-                button_states[BUTTON_LEFT] = (~i2c_buffer[i] & (1<<1)) > 0 ? 0 : 1;
-                button_states[BUTTON_A] = (~i2c_buffer[i] & (1<<4)) > 0 ? 0 : 1;
-                button_states[BUTTON_B] = (~i2c_buffer[i] & (1<<6)) > 0 ? 0 : 1;
-            }
-        }
-    }
-
-    if (!valid )
-    {
-        initialized = false;
-        sleep_ms(1000);
-        last_micros = time_us_32();
-    }
-
-    uint8_t buttondown = 0;
-    for (i = 0; i < BUTTON_COUNT; i++)
-    {
-        if (button_states[i] == 0)
-        {
-            buttondown = 1;
-        }
-    }
-    gpio_put(ONBOARD_LED_PIN, buttondown);
+    add_repeating_timer_us(-CONTROLLER_TICK_US, controller_tick, NULL, &controller_timer);
 }
 
-static void gpio_callback(uint gpio, uint32_t events) 
+// Buttons go straight on to the joypad pins; none while the OSD has them,
+// and the recording's own while replaying
+static bool controller_tick(repeating_timer_t* timer)
 {
-    // Prevent controller input to game if OSD is visible
-    if (OSD_is_enabled())
-        return;
-
-    if(gpio==BUTTONS_DPAD_PIN)
+    CONTROLLER_tick(time_us_32());
+    if (INPUTLOG_get_mode() != INPUTLOG_REPLAY)
     {
-        if (events & (1<<2))   // EDGE LOW -- Send DPAD on falling
-        {
-            gpio_put(BUTTONS_RIGHT_A_PIN, button_states[BUTTON_RIGHT]);
-            gpio_put(BUTTONS_LEFT_B_PIN, button_states[BUTTON_LEFT]);
-            gpio_put(BUTTONS_UP_SELECT_PIN, button_states[BUTTON_UP]);
-            gpio_put(BUTTONS_DOWN_START_PIN, button_states[BUTTON_DOWN]);
-        }
-        
-        if (events & (1<<3)) // EDGE HIGH -- Send BUTTONS on rising
-        {
-            gpio_put(BUTTONS_RIGHT_A_PIN, button_states[BUTTON_A]);
-            gpio_put(BUTTONS_LEFT_B_PIN, button_states[BUTTON_B]);
-            gpio_put(BUTTONS_UP_SELECT_PIN, button_states[BUTTON_SELECT]);
-            gpio_put(BUTTONS_DOWN_START_PIN, button_states[BUTTON_START]);
-
-            // Prevent Tetris in-game reset lockup
-            // If A,B,Select and Start are all pressed, release them!
-            if ((button_states[BUTTON_A] | button_states[BUTTON_B] | button_states[BUTTON_SELECT]| button_states[BUTTON_START])==0)
-            {
-                button_states[BUTTON_A] = 1;
-                button_states[BUTTON_B] = 1;
-                button_states[BUTTON_SELECT] = 1;
-                button_states[BUTTON_START] = 1;
-            }
-        }
-    }
-
-    // When *other* pin goes high read cycle complete, send all high
-    if(gpio==BUTTONS_OTHER_PIN && (events & (1<<3)))
-    {
-        gpio_put(BUTTONS_RIGHT_A_PIN, 1);
-        gpio_put(BUTTONS_LEFT_B_PIN, 1);
-        gpio_put(BUTTONS_UP_SELECT_PIN, 1);
-        gpio_put(BUTTONS_DOWN_START_PIN, 1);
+        JOYPAD_set_buttons(OSD_is_enabled() ? 0 : CONTROLLER_get_buttons());
     }
+    return true;
 }
 
-static void change_scheme_offset(int direction)
+// Latest published buttons, for the menu code
+static void read_controller(void)
 {
-    int max_offset = sizeof(colors)/sizeof(colors[0]) - 4;
-    scheme_offset += direction * 4;
-    scheme_offset = scheme_offset > max_offset ? 0 : scheme_offset;
-    scheme_offset = scheme_offset < 0 ? max_offset : scheme_offset;
-}
+    uint16_t pressed = CONTROLLER_get_buttons();
 
-static void change_border_color_index(int direction)
-{
-    border_color_index += direction;
-    border_color_index = border_color_index < 0 ? (sizeof(border_colors)-1) : border_color_index;
-    border_color_index = border_color_index >= sizeof(border_colors) ? 0 : border_color_index;
-}
-
-static void change_video_effect(int increment)
-{
-    video_effect += increment;
-    video_effect = video_effect >= VIDEO_EFFECT_COUNT ? VIDEO_EFFECT_NONE : video_effect;
-    video_effect = video_effect < 0 ? VIDEO_EFFECT_COUNT-1 : video_effect;
-}
-
-static void change_scanline_color(int increment)
-{
-    scanline_color_offset += increment;
-    scanline_color_offset = scanline_color_offset > 3 ? 0 : scanline_color_offset;
-    scanline_color_offset = scanline_color_offset < 0 ? 3 : scanline_color_offset;
-    scanline_color = colors[scheme_offset + scanline_color_offset];
+    for (int i = 0; i < BUTTON_COUNT; i++)
+    {
+        button_states[i] = (pressed & (1 << i)) ? 0 : 1;
+    }
+    gpio_put(ONBOARD_LED_PIN, pressed != 0);
 }
 
 static bool button_is_pressed(controller_button_t button)
@@ -839,10 +503,33 @@ static void command_check(void)
     if (button_was_released(BUTTON_HOME))
     {
         OSD_toggle();
+        if (osd_page != OSD_PAGE_MENU)
+        {
+            osd_page = OSD_PAGE_MENU;
+            update_osd();
+        }
+        RENDER_invalidate();
     }
     else
     {
-        if (OSD_is_enabled())
+        if (OSD_is_enabled() && osd_page == OSD_PAGE_DIAGNOSTICS)
+        {
+            // Read only page: left/right flip between render, capture and input, A goes back
+            if (button_was_released(BUTTON_RIGHT) || button_was_released(BUTTON_LEFT))
+            {
+                diag_view += button_was_released(BUTTON_LEFT) ? -1 : 1;
+                diag_view = diag_view >= DIAG_VIEW_COUNT ? 0 : diag_view;
+                diag_view = diag_view < 0 ? DIAG_VIEW_COUNT-1 : diag_view;
+                update_diagnostics();
+            }
+            else if (button_was_released(BUTTON_A))
+            {
+                osd_page = OSD_PAGE_MENU;
+                OSD_set_active_line(OSD_LINE_DIAGNOSTICS);
+                update_osd();
+            }
+        }
+        else if (OSD_is_enabled())
         {
             if (button_was_released(BUTTON_DOWN))
             {
@@ -860,26 +547,79 @@ static void command_check(void)
                 switch (OSD_get_active_line())
                 {
                     case OSD_LINE_COLOR_SCHEME:
-                        change_scheme_offset(leftbtn ? -1 : 1);
+                        RENDER_change_scheme(leftbtn ? -1 : 1);
                         update_osd();
                         break;
                     case OSD_LINE_BORDER_COLOR:
-                        change_border_color_index(leftbtn ? -1 : 1);
+                        RENDER_change_border_color(leftbtn ? -1 : 1);
                         update_osd();
                         break;
                     case OSD_LINE_EFFECTS:
-                        change_video_effect(leftbtn ? -1 : 1);
+                        RENDER_change_video_effect(leftbtn ? -1 : 1);
                         update_osd();
                         break;
                     case OSD_LINE_FX_SCHEME:
-                        change_scanline_color(leftbtn ? -1 : 1);
+                        RENDER_change_scanline_color(leftbtn ? -1 : 1);
+                        update_osd();
+                        break;
+                    case OSD_LINE_OUTPUT_MODE:
+                        // Left/right pick, A applies: a change drops the picture for a moment
+                        if (button_was_released(BUTTON_A))
+                        {
+                            apply_mode(pending_mode);
+                        }
+                        else
+                        {
+                            pending_mode += leftbtn ? -1 : 1;
+                            pending_mode = pending_mode >= RENDER_MODE_COUNT ? 0 : pending_mode;
+                            pending_mode = (int)pending_mode < 0 ? RENDER_MODE_COUNT-1 : pending_mode;
+                            update_osd();
+                        }
+                        break;
+                    case OSD_LINE_OSD_STYLE:
+                        RENDER_set_osd_translucent(!RENDER_get_osd_translucent());
+                        update_osd();
+                        break;
+                    case OSD_LINE_POLL_RATE:
+                        change_poll_rate(leftbtn ? -1 : 1);
+                        update_osd();
+                        break;
+                    case OSD_LINE_TURBO_A:
+                        TURBO_change_rate(BUTTON_A, leftbtn ? -1 : 1);
                         update_osd();
                         break;
+                    case OSD_LINE_TURBO_B:
+                        TURBO_change_rate(BUTTON_B, leftbtn ? -1 : 1);
+                        update_osd();
+                        break;
+                    case OSD_LINE_MACRO:
+                        TURBO_change_macro(leftbtn ? -1 : 1);
+                        update_osd();
+                        break;
+                    case OSD_LINE_INPUT:
+                        // As the mode: recording and replay reset the Game Boy
+                        if (button_was_released(BUTTON_A))
+                        {
+                            apply_input_mode(pending_input);
+                        }
+                        else
+                        {
+                            pending_input = (pending_input + (leftbtn ? -1 : 1) + INPUTLOG_MODE_COUNT)
+                                            % INPUTLOG_MODE_COUNT;
+                        }
+                        update_osd();
+                        break;
+                    case OSD_LINE_DIAGNOSTICS:
+                        osd_page = OSD_PAGE_DIAGNOSTICS;
+                        OSD_set_active_line(DIAG_LINE_BACK);
+                        update_diagnostics();
+                        break;
                     case OSD_LINE_RESET_GAMEBOY:
                         gameboy_reset();
                         break;
                     case OSD_LINE_EXIT:
                         OSD_toggle();
+                        RENDER_invalidate();
                         break;
                 }
             }
@@ -893,66 +633,352 @@ static void command_check(void)
     }
 }
 
-static void set_indexes(void)
-{
-    int i;
-    uint16_t n = 0;
-
-    uint16_t x;
-    for (x = 0; x < PIXELS_X; x++)
-    {
-        for (i = 0; i < PIXEL_SCALE; i++) 
-        {
-            indexes_x[n++] = x;
-        }
-    }
-
-    n = 0;
-    uint16_t y;
-    for (y = 0; y < PIXELS_Y; y++)
-    {
-        for (i = 0; i < PIXEL_SCALE; i++) 
-        {
-            indexes_y[n++] = y;
-        }
-    }
-}
-
 static void update_osd(void)
 {
     char buff[32];
-    sprintf(buff, "COLOR SCHEME:% 5d", scheme_offset/4);
+    sprintf(buff, "COLOR SCHEME:% 5d", RENDER_get_scheme());
     OSD_set_line_text(OSD_LINE_COLOR_SCHEME, buff);
 
-    sprintf(buff, "BORDER COLOR:% 5d", border_color_index);
+    sprintf(buff, "BORDER COLOR:% 5d", RENDER_get_border_color());
     OSD_set_line_text(OSD_LINE_BORDER_COLOR, buff);
 
-    if (video_effect==VIDEO_EFFECT_SCANLINES)
+    if (RENDER_get_video_effect()==VIDEO_EFFECT_SCANLINES)
     {
         sprintf(buff, "EFFECTS: SCANLINES");
     }
-    else if (video_effect==VIDEO_EFFECT_PIXEL_EFFECT)
+    else if (RENDER_get_video_effect()==VIDEO_EFFECT_PIXEL_EFFECT)
     {
         sprintf(buff, "EFFECTS:    PIXELS");
     }
+    else if (RENDER_get_video_effect()==VIDEO_EFFECT_FRAME_BLEND)
+    {
+        sprintf(buff, "EFFECTS:     BLEND");
+    }
+    else if (RENDER_get_video_effect()==VIDEO_EFFECT_SCALE3X)
+    {
+        sprintf(buff, "EFFECTS:   SCALE3X");
+    }
     else
     {
         sprintf(buff, "EFFECTS:      NONE");
     }
     OSD_set_line_text(OSD_LINE_EFFECTS, buff);
 
-    sprintf(buff, "FX SCHEME:% 8d", scanline_color_offset);
+    sprintf(buff, "FX SCHEME:% 8d", RENDER_get_scanline_color());
     OSD_set_line_text(OSD_LINE_FX_SCHEME, buff);
 
+    // Mode picked but not applied yet is marked with a '!'
+    sprintf(buff, "MODE:%c%12s", pending_mode == RENDER_get_mode() ? ' ' : '!',
+            RENDER_get_mode_info(pending_mode)->name);
+    OSD_set_line_text(OSD_LINE_OUTPUT_MODE, buff);
+
+    sprintf(buff, "OSD:%14s", RENDER_get_osd_translucent() ? "TRANSLUCENT" : "SOLID");
+    OSD_set_line_text(OSD_LINE_OSD_STYLE, buff);
+
+    sprintf(buff, "POLL RATE:%5d HZ", CONTROLLER_get_poll_rate());
+    OSD_set_line_text(OSD_LINE_POLL_RATE, buff);
+
+    sprintf(buff, "TURBO A:%10s", TURBO_get_rate_name(BUTTON_A));
+    OSD_set_line_text(OSD_LINE_TURBO_A, buff);
+
+    sprintf(buff, "TURBO B:%10s", TURBO_get_rate_name(BUTTON_B));
+    OSD_set_line_text(OSD_LINE_TURBO_B, buff);
+
+    sprintf(buff, "MACRO:%12s", TURBO_get_macro_name());
+    OSD_set_line_text(OSD_LINE_MACRO, buff);
+
+    static const char* const input_modes[INPUTLOG_MODE_COUNT] = { "LIVE", "RECORDING", "REPLAY" };
+    sprintf(buff, "INPUT:%c%11s", pending_input == INPUTLOG_get_mode() ? ' ' : '!',
+            input_modes[pending_input]);
+    OSD_set_line_text(OSD_LINE_INPUT, buff);
+
+    OSD_set_line_text(OSD_LINE_DIAGNOSTICS, "DIAGNOSTICS");
     OSD_set_line_text(OSD_LINE_RESET_GAMEBOY, "RESET GAMEBOY");
     OSD_set_line_text(OSD_LINE_EXIT, "EXIT");
+}
+
+static void update_diagnostics(void)
+{
+    char buff[32];
+
+    if (diag_view == DIAG_VIEW_INPUT)
+    {
+        controller_stats_t controller;
+        controller_latency_t latency;
+        uint32_t now_us = time_us_32();
+
+        CONTROLLER_get_stats(&controller);
+        CONTROLLER_get_latency(&latency);
+
+        sprintf(buff, "SYNC:%13s", !CONTROLLER_is_connected() ? "NO PAD"
+                : CONTROLLER_is_synced(now_us) ? "LOCKED" : "FREE");
+        OSD_set_line_text(DIAG_LINE_SYNC, buff);
+
+        sprintf(buff, "READ PERIOD:%6lu", (unsigned long)CONTROLLER_get_read_period_us());
+        OSD_set_line_text(DIAG_LINE_READ_PERIOD, buff);
+
+        // Age of the buttons the game read since the last refresh, in us
+        static controller_latency_t last_latency;
+        controller_latency_t recent = latency;
+        recent.reads -= last_latency.reads;
+        for (int i = 0; i < CONTROLLER_AGE_BUCKETS; i++)
+        {
+            recent.histogram[i] -= last_latency.histogram[i];
+        }
+        last_latency = latency;
+
+        sprintf(buff, "AGE P50:%10lu", (unsigned long)CONTROLLER_age_percentile(&recent, 50));
+        OSD_set_line_text(DIAG_LINE_AGE_P50, buff);
+
+        sprintf(buff, "AGE P99:%10lu", (unsigned long)CONTROLLER_age_percentile(&recent, 99));
+        OSD_set_line_text(DIAG_LINE_AGE_P99, buff);
+
+        sprintf(buff, "AGE MAX:%10lu", (unsigned long)latency.worst_us);
+        OSD_set_line_text(DIAG_LINE_AGE_MAX, buff);
+
+        sprintf(buff, "PAD:%14s", CONTROLLER_get_profile_name());
+        OSD_set_line_text(DIAG_LINE_PAD, buff);
+
+        sprintf(buff, "BUS ERRORS:%7lu", (unsigned long)controller.bus_errors);
+        OSD_set_line_text(DIAG_LINE_BUS_ERRORS, buff);
+    }
+    else if (diag_view == DIAG_VIEW_CAPTURE)
+    {
+        capture_stats_t capture;
+        CAPTURE_get_stats(&capture);
+
+        sprintf(buff, "FRAMES:%11lu", (unsigned long)capture.frames);
+        OSD_set_line_text(DIAG_LINE_FRAMES, buff);
 
-    OSD_update_framebuffer();
+        sprintf(buff, "SHORT FRAMES:%5lu", (unsigned long)capture.short_frames);
+        OSD_set_line_text(DIAG_LINE_SHORT, buff);
+
+        sprintf(buff, "LONG FRAMES:%6lu", (unsigned long)capture.long_frames);
+        OSD_set_line_text(DIAG_LINE_LONG, buff);
+
+        sprintf(buff, "RESYNCS:%10lu", (unsigned long)capture.resyncs);
+        OSD_set_line_text(DIAG_LINE_RESYNCS, buff);
+
+        sprintf(buff, "LAST LINES:%7lu", (unsigned long)capture.last_lines);
+        OSD_set_line_text(DIAG_LINE_LINES, buff);
+
+        sprintf(buff, "PERIOD US:%8lu", (unsigned long)capture.frame_period_us);
+        OSD_set_line_text(DIAG_LINE_PERIOD, buff);
+
+        for (int line = DIAG_LINE_PERIOD + 1; line < DIAG_LINE_BACK; line++)
+        {
+            OSD_set_line_text(line, "");
+        }
+    }
+    else
+    {
+        linestats_t lines;
+        render_stats_t render;
+
+        LINESTATS_get(&lines);
+        RENDER_get_stats(&render);
+
+        // Render times are in CPU cycles per scanline
+        sprintf(buff, "LINE AVG:%9lu", (unsigned long)lines.frame_avg);
+        OSD_set_line_text(DIAG_LINE_AVG, buff);
+
+        sprintf(buff, "LINE P99:%9lu", (unsigned long)lines.frame_p99);
+        OSD_set_line_text(DIAG_LINE_P99, buff);
+
+        sprintf(buff, "LINE MAX:%9lu", (unsigned long)lines.frame_max);
+        OSD_set_line_text(DIAG_LINE_MAX, buff);
+
+        sprintf(buff, "BUDGET:%11lu", (unsigned long)line_budget_cycles());
+        OSD_set_line_text(DIAG_LINE_BUDGET, buff);
+
+        sprintf(buff, "LATE LINES:%7lu", (unsigned long)lines.late);
+        OSD_set_line_text(DIAG_LINE_LATE, buff);
+
+        // Percentage of composed Game Boy lines served from the line cache
+        uint32_t reused = render.line_cache_hits + render.line_cache_replicas;
+        uint32_t total = reused + render.line_cache_misses;
+        sprintf(buff, "CACHE HIT:%8lu", (unsigned long)(total ? (uint64_t)reused * 100 / total : 0));
+        OSD_set_line_text(DIAG_LINE_CACHE, buff);
+
+        // Percentage of output lines core 0 rendered since the last refresh
+        static uint32_t last_core_lines[RENDER_CORES];
+        uint32_t core0 = render.core_lines[0] - last_core_lines[0];
+        uint32_t core1 = render.core_lines[1] - last_core_lines[1];
+        sprintf(buff, "CORE0 SHARE:%6lu", (unsigned long)(core0 + core1 ? (uint64_t)core0 * 100 / (core0 + core1) : 0));
+        OSD_set_line_text(DIAG_LINE_CORES, buff);
+        memcpy(last_core_lines, render.core_lines, sizeof(last_core_lines));
+    }
+
+    OSD_set_line_text(DIAG_LINE_BACK, "BACK");
+    for (int line = DIAG_LINE_COUNT; line < OSD_LINES; line++)
+    {
+        OSD_set_line_text(line, "");
+    }
+
+    diag_refresh_ms = to_ms_since_boot(get_absolute_time());
+}
+
+// Steps through poll_rates, wrapping like the other menu settings
+static void change_poll_rate(int direction)
+{
+    const int count = sizeof(poll_rates) / sizeof(poll_rates[0]);
+    int index = 0;
+
+    while (index < count - 1 && poll_rates[index] < CONTROLLER_get_poll_rate())
+    {
+        index++;
+    }
+    index = (index + direction + count) % count;
+    CONTROLLER_set_poll_rate(poll_rates[index]);
+}
+
+// Recording and replay both start from a Game Boy reset, so the game's
+// joypad reads line up with the recording's
+static void apply_input_mode(inputlog_mode_t mode)
+{
+    if (mode == INPUTLOG_get_mode())
+        return;
+
+#if INPUTLOG_EXPORT
+    // Stopped first, so the ring holds still while it is printed
+    if (INPUTLOG_get_mode() == INPUTLOG_RECORD)
+    {
+        INPUTLOG_stop();
+        export_recording();
+    }
+#endif
+    INPUTLOG_stop();
+
+    if (mode == INPUTLOG_RECORD)
+    {
+        gameboy_reset();
+        INPUTLOG_start_recording();
+    }
+    else if (mode == INPUTLOG_REPLAY)
+    {
+        uint16_t first;
+        gameboy_reset();
+        if (INPUTLOG_start_replay(&first))
+        {
+            JOYPAD_replay_buttons(first);
+        }
+    }
+
+    // Live again if there was nothing to replay
+    pending_input = INPUTLOG_get_mode();
+}
+
+#if INPUTLOG_EXPORT
+// Hex over USB serial, for gb_vga_host -r
+static void export_recording(void)
+{
+    int column = 0;
+    INPUTLOG_export(export_write, &column);
+    printf("%sINPUTLOG END\n", column ? "\n" : "");
+}
+
+static void export_write(const uint8_t* data, size_t length, void* context)
+{
+    int* column = context;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        if (*column == 0)
+        {
+            printf("INPUTLOG ");
+        }
+        printf("%02X", data[i]);
+        if (++*column == 32)
+        {
+            printf("\n");
+            *column = 0;
+        }
+    }
+}
+#endif
+
+// CPU cycles per output scanline at the current system clock
+static uint32_t line_budget_cycles(void)
+{
+    const scanvideo_timing_t* timing = vga_mode->default_timing;
+    return (uint64_t)clock_get_hz(clk_sys) * timing->h_total / timing->clock_freq;
 }
 
 static void gameboy_reset(void)
 {
     gpio_put(GAMEBOY_RESET_PIN, 0);
-    sleep_ms(50);
+    idle_ms(50);
     gpio_put(GAMEBOY_RESET_PIN, 1);
 }
+
+// Mode left in the watchdog scratch registers by apply_mode(), else the default
+static render_mode_t boot_mode(void)
+{
+    if (watchdog_caused_reboot() && watchdog_hw->scratch[0] == MODE_SCRATCH_MAGIC
+        && (watchdog_hw->scratch[1] & 0xFF) < RENDER_MODE_COUNT)
+    {
+        return (render_mode_t)(watchdog_hw->scratch[1] & 0xFF);
+    }
+
+    return RENDER_MODE_640X480_3X;
+}
+
+// The rest of what apply_mode() left, stepped to from the defaults so each
+// setting goes through its usual range checks
+static void restore_settings(void)
+{
+    if (!watchdog_caused_reboot() || watchdog_hw->scratch[0] != MODE_SCRATCH_MAGIC)
+        return;
+
+    uint32_t render = watchdog_hw->scratch[1];
+    uint32_t output = watchdog_hw->scratch[2];
+    uint32_t input = watchdog_hw->scratch[3];
+    watchdog_hw->scratch[0] = 0;
+
+    RENDER_change_scheme((int)((render >> 8) & 0xFF) - RENDER_get_scheme());
+    RENDER_change_border_color((int)((render >> 16) & 0xFF) - RENDER_get_border_color());
+    RENDER_change_video_effect((int)((render >> 24) & 0xFF) - (int)RENDER_get_video_effect());
+    RENDER_change_scanline_color((int)(output & 0xFF) - RENDER_get_scanline_color());
+    RENDER_set_osd_translucent((output >> 8) & 1);
+    CONTROLLER_set_poll_rate(output >> 16);
+
+    TURBO_change_rate(BUTTON_A, (int)(input & 0xFF) - TURBO_get_rate(BUTTON_A));
+    TURBO_change_rate(BUTTON_B, (int)((input >> 8) & 0xFF) - TURBO_get_rate(BUTTON_B));
+    TURBO_change_macro((int)((input >> 16) & 0xFF) - TURBO_get_macro());
+}
+
+// The Game Boy reset pin floats low, the pad's default, from the reboot
+// until main() drives it again, so the game may restart unless the board
+// pulls the line up.  The settings and any input recording are kept.
+static void apply_mode(render_mode_t mode)
+{
+    if (mode == RENDER_get_mode())
+        return;
+
+    watchdog_hw->scratch[0] = MODE_SCRATCH_MAGIC;
+    watchdog_hw->scratch[1] = mode
+                              | RENDER_get_scheme() << 8
+                              | RENDER_get_border_color() << 16
+                              | (uint32_t)RENDER_get_video_effect() << 24;
+    watchdog_hw->scratch[2] = RENDER_get_scanline_color()
+                              | RENDER_get_osd_translucent() << 8
+                              | CONTROLLER_get_poll_rate() << 16;
+    watchdog_hw->scratch[3] = TURBO_get_rate(BUTTON_A)
+                              | TURBO_get_rate(BUTTON_B) << 8
+                              | TURBO_get_macro() << 16;
+
+#if INPUTLOG_EXPORT
+    if (INPUTLOG_get_mode() == INPUTLOG_RECORD)
+    {
+        INPUTLOG_stop();
+        export_recording();
+    }
+#endif
+    INPUTLOG_keep();
+    watchdog_reboot(0, 0, 0);
+
+    while (true)
+    {
+        tight_loop_contents();
+    }
+}
@@ -0,0 +1,1230 @@
+/*
+    Host harness for the gb_vga renderer.
+
+    Drives a test card through the LCD capture model into the frame store,
+    renders output frames with the same render.c / osd.c the board runs and
+    decodes the composable scanline tokens back into pixels.  Writes the last
+    frame as a PPM and can time the renderer.  Every output mode is rendered
+    and checked, run-length encoded lines against raw ones; the PPM and the
+    timings come from the -M mode.  -c picks the picture: 0 test card,
+    1 mostly blank, 2 one pixel dither (worst case for run-length encoding),
+    3 test card with a box flickering on alternate frames (for frame blend).
+    -m shows the OSD menu, -t makes it translucent.
+    The Scale3x pass runs between output frames, as on core 0.
+    The late scanline count is fed lines as both cores take them.
+    The controller state machine is run against a model of the I2C bus and a
+    Wii Classic controller first: start up, polling, a slow device, unplug,
+    reset and a stuck bus, then against a game reading the joypad once a
+    frame, free running and synced to the reads.  Each controller profile
+    is identified from a model's ID and decoded, the NES pad through a
+    model of its shift register.  Every turbo and macro setting is played
+    through joypad.c and a model of its joypad matrix, read for read.  Input
+    recordings are made and replayed through joypad.c's read handlers the
+    same way, and round tripped through inputlog.c's export and import.
+    -r replays a recording the board printed (INPUTLOG lines, see
+    GB_VGA_INPUTLOG_EXPORT) the same way and exits.
+
+    The image hash is printed with the PPM; -g fails the run unless it
+    matches, see golden.txt.
+
+    usage: gb_vga_host [-o out.ppm] [-n frames] [-s scheme] [-b border]
+                       [-e effect] [-x fx] [-m] [-t] [-M mode] [-c card]
+                       [-g hash] [-B bench_frames] [-r recording.txt]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "pico/scanvideo.h"
+#include "frame_layout.h"
+#include "framestore.h"
+#include "capture.h"
+#include "controller.h"
+#include "i2c_model.h"
+#include "inputlog.h"
+#include "joypad.h"
+#include "joypad_model.h"
+#include "linestats.h"
+#include "nes_pad_model.h"
+#include "lcd_capture_model.h"
+#include "osd.h"
+#include "render.h"
+#include "scanline_decode.h"
+#include "turbo.h"
+
+typedef enum
+{
+    OSD_LINE_COLOR_SCHEME = 0,
+    OSD_LINE_BORDER_COLOR,
+    OSD_LINE_EFFECTS,
+    OSD_LINE_FX_SCHEME,
+    OSD_LINE_OUTPUT_MODE,
+    OSD_LINE_OSD_STYLE,
+    OSD_LINE_POLL_RATE,
+    OSD_LINE_TURBO_A,
+    OSD_LINE_TURBO_B,
+    OSD_LINE_MACRO,
+    OSD_LINE_INPUT,
+    OSD_LINE_DIAGNOSTICS,
+    OSD_LINE_RESET_GAMEBOY,
+    OSD_LINE_EXIT,
+    OSD_LINE_COUNT
+} osd_line_t;
+
+static lcd_capture_model_t lcd;
+static uint32_t scanline[PICO_SCANVIDEO_MAX_SCANLINE_BUFFER_WORDS];
+static uint8_t image[RENDER_MAX_HEIGHT][RENDER_MAX_WIDTH];
+static uint8_t raw_image[RENDER_MAX_HEIGHT][RENDER_MAX_WIDTH];
+static uint16_t output_frame = 0;
+static int card = 0;
+static uint32_t joypad_period_us = 0;       // game's joypad read period, 0 for none
+static uint32_t next_joypad_us = 0;
+
+// The joypad pins as gb_vga.c wires them: P14, then P10-P13
+#define JOYPAD_P14_PIN          (19)
+static const uint8_t joypad_lines[4] = { 27, 26, 22, 21 };
+
+// Joypad reads in the input recording check, one a frame
+#define INPUT_READS_PER_MINUTE  (60 * 60)
+#define INPUT_CHECK_READS       (30 * INPUT_READS_PER_MINUTE)
+static uint8_t input_export[INPUTLOG_BYTES + 64];
+static size_t input_export_length = 0;
+unsigned host_core_num = 1;
+
+//**********************************************************************************************
+// PRIVATE FUNCTION PROTOTYPES
+//**********************************************************************************************
+static uint8_t test_pixel(int frame, int x, int y);
+static void capture_frame(int frame);
+static int render_frame(bool decode);
+static int check_rle(void);
+static int check_linestats(void);
+static int check_controller(void);
+static int check_profiles(void);
+static uint32_t run_controller(uint32_t now_us, uint32_t for_us);
+static int measure_latency(uint32_t* now_us, const char* name, uint32_t* p99_us);
+static int check_turbo(void);
+static void turbo_reads(uint16_t pressed, int reads, uint16_t* seen);
+static int check_inputlog(void);
+static void record_input(const uint16_t* sequence, uint32_t reads, uint16_t* seen);
+static int replay_input(const uint16_t* expected, uint32_t* reads, uint32_t* held);
+static int round_trip_input(void);
+static void export_write(const uint8_t* data, size_t length, void* context);
+static int replay_file(const char* path);
+static uint64_t run_smoother(void);
+static uint32_t image_hash(void);
+static void update_osd(void);
+static bool write_ppm(const char *path);
+static uint64_t now_ns(void);
+static void benchmark(int frames);
+static void benchmark_frames(int frames, uint64_t *total_ns, uint64_t *worst_ns, uint64_t *play_words);
+
+//**********************************************************************************************
+// PUBLIC FUNCTIONS
+//**********************************************************************************************
+int main(int argc, char *argv[])
+{
+    const char *output = "gb_vga.ppm";
+    int frames = 2;
+    int scheme = 0;
+    int border = 0;
+    int effect = 0;
+    int fx = 0;
+    bool osd = false;
+    bool translucent = false;
+    int bench_frames = 0;
+    render_mode_t mode = RENDER_MODE_640X480_3X;
+    const char *golden = NULL;
+    const char *recording = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "o:n:s:b:e:x:mtM:c:g:B:r:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'o': output = optarg; break;
+            case 'n': frames = atoi(optarg); break;
+            case 's': scheme = atoi(optarg); break;
+            case 'b': border = atoi(optarg); break;
+            case 'e': effect = atoi(optarg); break;
+            case 'x': fx = atoi(optarg); break;
+            case 'm': osd = true; break;
+            case 't': translucent = true; break;
+            case 'M': mode = atoi(optarg); break;
+            case 'c': card = atoi(optarg); break;
+            case 'g': golden = optarg; break;
+            case 'B': bench_frames = atoi(optarg); break;
+            case 'r': recording = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-o out.ppm] [-n frames] [-s scheme] [-b border] "
+                                "[-e effect] [-x fx] [-m] [-t] [-M mode] [-c card] [-g hash] [-B bench_frames] "
+                                "[-r recording.txt]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    if (mode >= RENDER_MODE_COUNT)
+    {
+        fprintf(stderr, "mode must be 0..%d\n", RENDER_MODE_COUNT - 1);
+        return 2;
+    }
+
+    JOYPAD_init(JOYPAD_P14_PIN, joypad_lines);
+    if (check_linestats() != 0 || check_controller() != 0 || check_profiles() != 0 || check_turbo() != 0
+        || check_inputlog() != 0)
+    {
+        return 1;
+    }
+
+    if (recording != NULL)
+    {
+        return replay_file(recording) == 0 ? 0 : 1;
+    }
+
+    FRAMESTORE_init();
+    OSD_init();
+    RENDER_init(mode);
+    LCD_MODEL_init(&lcd);
+
+    RENDER_change_scheme(scheme);
+    RENDER_change_border_color(border);
+    RENDER_change_video_effect(effect);
+    RENDER_change_scanline_color(fx);
+    RENDER_set_osd_translucent(translucent);
+
+    if (osd)
+    {
+        OSD_toggle();
+    }
+    update_osd();
+
+    for (int f = 0; f < frames; f++)
+    {
+        capture_frame(f);
+        if (render_frame(false) != 0)
+        {
+            return 1;
+        }
+        run_smoother();
+    }
+
+    // Every other mode must decode to its full width too; the image is left
+    // holding the -M mode
+    for (render_mode_t m = 0; m < RENDER_MODE_COUNT; m++)
+    {
+        if (m == mode)
+            continue;
+
+        RENDER_set_mode(m);
+        if (check_rle() != 0)
+        {
+            return 1;
+        }
+    }
+    // Switching modes dropped any Scale3x result; run a pass again first
+    RENDER_set_mode(mode);
+    render_frame(false);
+    run_smoother();
+    if (check_rle() != 0)
+    {
+        return 1;
+    }
+
+    if (!write_ppm(output))
+    {
+        return 1;
+    }
+    printf("wrote %s (%u frames captured, %u resyncs, %u short), hash %08x\n", output,
+           lcd.frame_count, lcd.resync_count, lcd.short_frames, image_hash());
+
+    if (golden != NULL && strtoul(golden, NULL, 16) != image_hash())
+    {
+        fprintf(stderr, "image hash %08x, golden %s\n", image_hash(), golden);
+        return 1;
+    }
+
+    if (bench_frames > 0)
+    {
+        benchmark(bench_frames);
+    }
+
+    return 0;
+}
+
+//**********************************************************************************************
+// PRIVATE FUNCTIONS
+//**********************************************************************************************
+// Test card: shade bands on top, a checkerboard, and a bar that moves with the frame
+static uint8_t test_pixel(int frame, int x, int y)
+{
+    if (card == 1)
+    {
+        // Blank screen with a few rows of text-sized detail
+        return (y / 8) % 4 == 1 && ((x / 2) % 5) < 3 && x > 16 && x < 144 ? 3 : 0;
+    }
+    if (card == 2)
+    {
+        return ((x + y + frame) & 1) ? 3 : 0;
+    }
+    if (card == 3 && (frame & 1) && x >= 48 && x < 112 && y >= 40 && y < 104)
+    {
+        return 3;
+    }
+
+    if (y < 16)
+    {
+        return (x / 40) & 3;
+    }
+    if (y >= PIXELS_Y - 16)
+    {
+        return (((x + frame) / 8) & 1) ? 3 : 0;
+    }
+    return (((x / 8) ^ (y / 8)) & 1) ? 2 : 1;
+}
+
+// Plays one frame of test_pixel() into the capture model as LCD pin samples
+static void capture_frame(int frame)
+{
+    // VBLANK, VSYNC low
+    for (int i = 0; i < 16; i++)
+    {
+        LCD_MODEL_sample(&lcd, 0);
+    }
+
+    for (int y = 0; y < PIXELS_Y; y++)
+    {
+        uint8_t vsync = (y == 0) ? LCD_SAMPLE_VSYNC : 0;
+
+        for (int x = 0; x < PIXELS_X; x++)
+        {
+            uint8_t shade = test_pixel(frame, x, y);
+            uint8_t data = ((shade >> 1) ? LCD_SAMPLE_DATA_0 : 0) | ((shade & 1) ? LCD_SAMPLE_DATA_1 : 0);
+
+            // First pixel is latched by HSYNC falling, the rest by the pixel clock
+            uint8_t strobe = (x == 0) ? LCD_SAMPLE_HSYNC : LCD_SAMPLE_PIXEL_CLOCK;
+            LCD_MODEL_sample(&lcd, vsync | strobe | data);
+            LCD_MODEL_sample(&lcd, vsync | data);
+        }
+    }
+}
+
+static int render_frame(bool decode)
+{
+    const render_mode_info_t *info = RENDER_get_mode_info(RENDER_get_mode());
+
+    for (int line = 0; line < info->height; line++)
+    {
+        int32_t words = RENDER_scanline(scanline, count_of(scanline), line, output_frame);
+
+        if (decode)
+        {
+            int count = DECODE_scanline(scanline, words, image[line], RENDER_MAX_WIDTH);
+            if (count != info->width)
+            {
+                fprintf(stderr, "%s line %d: decoded %d pixels, expected %d\n", info->name, line, count, info->width);
+                return -1;
+            }
+        }
+    }
+
+    output_frame++;
+    return 0;
+}
+
+// Renders the current mode raw, then run-length encoded, and checks both decode
+// to the same picture
+static int check_rle(void)
+{
+    const render_mode_info_t *info = RENDER_get_mode_info(RENDER_get_mode());
+    bool rle = RENDER_get_rle_enabled();
+
+    RENDER_set_rle_enabled(false);
+    if (render_frame(true) != 0)
+    {
+        return -1;
+    }
+    memcpy(raw_image, image, sizeof(image));
+
+    RENDER_set_rle_enabled(true);
+    if (render_frame(true) != 0)
+    {
+        return -1;
+    }
+
+    RENDER_set_rle_enabled(rle);
+
+    if (memcmp(raw_image, image, sizeof(image)) != 0)
+    {
+        fprintf(stderr, "%s: run-length encoded frame differs from raw\n", info->name);
+        return -1;
+    }
+
+    printf("mode %s: %dx%d ok\n", info->name, info->width, info->height);
+    return 0;
+}
+
+#define LINESTATS_CHECK_HEIGHT  (600)
+#define LINESTATS_CHECK_FRAMES  (3)
+
+// Scanlines taken the way the two rendering cores take them from scanvideo:
+// in turn, with every third pair reported the wrong way round as when the
+// cores race, and across the frame number wrapping.  With every line taken
+// none may be late; with every seventh skipped, exactly those must be.
+static int check_linestats(void)
+{
+    static uint16_t frames[LINESTATS_CHECK_FRAMES * LINESTATS_CHECK_HEIGHT];
+    static uint16_t lines[LINESTATS_CHECK_FRAMES * LINESTATS_CHECK_HEIGHT];
+    uint16_t frame = 0xFFFE;
+    linestats_t stats;
+
+    LINESTATS_init(LINESTATS_CHECK_HEIGHT);
+
+    for (int skip = 0; skip < 2; skip++)
+    {
+        uint32_t taken = 0;
+        uint32_t skipped = 0;
+
+        LINESTATS_get(&stats);
+        uint32_t late_before = stats.late;
+
+        for (int f = 0; f < LINESTATS_CHECK_FRAMES; f++, frame++)
+        {
+            for (int line = 0; line < LINESTATS_CHECK_HEIGHT; line++)
+            {
+                if (skip && line % 7 == 3)
+                {
+                    skipped++;
+                    continue;
+                }
+                frames[taken] = frame;
+                lines[taken] = line;
+                taken++;
+            }
+        }
+
+        for (uint32_t n = 0; n < taken; n++)
+        {
+            uint32_t i = n;
+            if ((n / 2) % 3 == 0 && n + 1 < taken)
+            {
+                i = n ^ 1;
+            }
+            LINESTATS_taken(frames[i], lines[i]);
+        }
+
+        LINESTATS_get(&stats);
+        if (stats.late - late_before != skipped)
+        {
+            fprintf(stderr, "linestats: %u late lines, %u skipped\n", stats.late - late_before, skipped);
+            return -1;
+        }
+    }
+
+    printf("linestats: ok (late lines counted across both cores)\n");
+    return 0;
+}
+
+#define CONTROLLER_FAIL(...)    do { fprintf(stderr, "controller: " __VA_ARGS__); return -1; } while (0)
+
+// Steps the state machine through the cases that used to stall or leave
+// buttons held with the blocking driver, in simulated time
+static int check_controller(void)
+{
+    const uint16_t a = 1 << BUTTON_A;
+    const uint16_t b = 1 << BUTTON_B;
+    const uint16_t up_start = (1 << BUTTON_UP) | (1 << BUTTON_START);
+    controller_stats_t stats;
+    i2c_model_stats_t bus;
+    uint32_t now = 0;
+
+    I2C_MODEL_reset();
+    I2C_MODEL_set_buttons(a);
+    CONTROLLER_init(now);
+
+    // Nothing on the bus while the controller powers up
+    now = run_controller(now, 1990 * 1000);
+    I2C_MODEL_get_stats(&bus);
+    if (bus.writes + bus.reads != 0 || CONTROLLER_get_buttons() != 0)
+        CONTROLLER_FAIL("bus used before the power up delay\n");
+
+    now = run_controller(now, 100 * 1000);
+    if (!I2C_MODEL_is_initialised() || !CONTROLLER_is_connected() || CONTROLLER_get_buttons() != a)
+        CONTROLLER_FAIL("no buttons after the handshake\n");
+
+    // Polled at the poll rate
+    CONTROLLER_get_stats(&stats);
+    uint32_t polls = stats.polls;
+    I2C_MODEL_set_buttons(up_start);
+    now = run_controller(now, 1000 * 1000);
+    CONTROLLER_get_stats(&stats);
+    if (CONTROLLER_get_buttons() != up_start)
+        CONTROLLER_FAIL("buttons %04x, expected %04x\n", CONTROLLER_get_buttons(), up_start);
+    if (stats.polls - polls < CONTROLLER_DEFAULT_POLL_HZ - 1)
+        CONTROLLER_FAIL("%u polls in a second\n", stats.polls - polls);
+
+    // A slow device only delays the poll
+    I2C_MODEL_set_latency(3);
+    I2C_MODEL_set_buttons(b);
+    now = run_controller(now, 100 * 1000);
+    I2C_MODEL_set_latency(0);
+    CONTROLLER_get_stats(&stats);
+    if (CONTROLLER_get_buttons() != b || stats.bus_errors != 0)
+        CONTROLLER_FAIL("slow device: buttons %04x, %u bus errors\n", CONTROLLER_get_buttons(), stats.bus_errors);
+
+    // Unplugged: buttons let go within a few polls, then retried
+    I2C_MODEL_set_present(false);
+    now = run_controller(now, 100 * 1000);
+    if (CONTROLLER_is_connected() || CONTROLLER_get_buttons() != 0)
+        CONTROLLER_FAIL("buttons still held after unplugging\n");
+    now = run_controller(now, 2000 * 1000);
+    I2C_MODEL_set_present(true);
+    now = run_controller(now, 1500 * 1000);
+    if (!CONTROLLER_is_connected() || CONTROLLER_get_buttons() != b)
+        CONTROLLER_FAIL("not back after plugging in again\n");
+
+    // Controller reset: 0xFF reports until the handshake is sent again
+    CONTROLLER_get_stats(&stats);
+    uint32_t handshakes = stats.handshakes;
+    I2C_MODEL_forget_init();
+    now = run_controller(now, 1500 * 1000);
+    CONTROLLER_get_stats(&stats);
+    if (stats.invalid_reads == 0 || stats.handshakes == handshakes || CONTROLLER_get_buttons() != b)
+        CONTROLLER_FAIL("no new handshake after a controller reset\n");
+
+    // Stuck bus: transfers time out and are aborted, nothing stays held
+    I2C_MODEL_set_stuck(true);
+    now = run_controller(now, 200 * 1000);
+    I2C_MODEL_get_stats(&bus);
+    if (bus.aborts == 0 || CONTROLLER_get_buttons() != 0)
+        CONTROLLER_FAIL("stuck bus not aborted\n");
+    I2C_MODEL_set_stuck(false);
+    now = run_controller(now, 1500 * 1000);
+    if (CONTROLLER_get_buttons() != b)
+        CONTROLLER_FAIL("not back after the bus was freed\n");
+
+    CONTROLLER_get_stats(&stats);
+    printf("controller: ok (%u polls, %u bus errors, %u invalid reads, %u handshakes)\n",
+           stats.polls, stats.bus_errors, stats.invalid_reads, stats.handshakes);
+
+    // A game reading the joypad once a Game Boy frame, at some phase
+    uint32_t free_p99, synced_p99, fast_p99;
+    joypad_period_us = 16743;
+    next_joypad_us = now + 5371;
+
+    CONTROLLER_set_sync_enabled(false);
+    if (measure_latency(&now, "free 60 Hz", &free_p99) != 0)
+        return -1;
+    if (CONTROLLER_is_synced(now))
+        CONTROLLER_FAIL("synced with sync off\n");
+
+    CONTROLLER_set_sync_enabled(true);
+    if (measure_latency(&now, "synced 60 Hz", &synced_p99) != 0)
+        return -1;
+    if (!CONTROLLER_is_synced(now))
+        CONTROLLER_FAIL("not synced to the joypad reads, period %u us\n", CONTROLLER_get_read_period_us());
+
+    CONTROLLER_set_poll_rate(240);
+    if (measure_latency(&now, "synced 240 Hz", &fast_p99) != 0)
+        return -1;
+    if (synced_p99 > 2 * CONTROLLER_AGE_BUCKET_US || fast_p99 > 2 * CONTROLLER_AGE_BUCKET_US || free_p99 <= synced_p99)
+        CONTROLLER_FAIL("synced polls not ahead of the reads\n");
+
+    // The game stops reading: back to free running at the poll rate
+    joypad_period_us = 0;
+    now = run_controller(now, 200 * 1000);
+    CONTROLLER_get_stats(&stats);
+    polls = stats.polls;
+    now = run_controller(now, 1000 * 1000);
+    CONTROLLER_get_stats(&stats);
+    if (CONTROLLER_is_synced(now) || stats.polls - polls < 240 - 1)
+        CONTROLLER_FAIL("%u free polls in a second after the reads stopped\n", stats.polls - polls);
+    CONTROLLER_set_poll_rate(CONTROLLER_DEFAULT_POLL_HZ);
+
+    return 0;
+}
+
+#define PROFILE_FAIL(...)       do { fprintf(stderr, "profiles: " __VA_ARGS__); return -1; } while (0)
+
+// Each controller the decoder knows is identified once at connect and
+// decoded through its own table
+static int check_profiles(void)
+{
+    static const uint8_t pro_id[6] = { 0x01, 0x00, 0xA4, 0x20, 0x01, 0x01 };
+    static const uint8_t clone_id[6] = { 0x00, 0x00, 0xA4, 0x20, 0x03, 0x01 };
+    const uint16_t a = 1 << BUTTON_A;
+    const uint16_t b = 1 << BUTTON_B;
+    const uint8_t y_x = (1 << 5) | (1 << 3);    // report byte 5
+    i2c_model_stats_t bus;
+    uint32_t now = 0;
+
+    // Wii Classic: Y and X are not buttons
+    I2C_MODEL_reset();
+    I2C_MODEL_set_buttons(a);
+    I2C_MODEL_set_extra_bits(5, y_x);
+    CONTROLLER_init(now);
+    if (strcmp(CONTROLLER_get_profile_name(), "NONE") != 0)
+        PROFILE_FAIL("%s before the handshake\n", CONTROLLER_get_profile_name());
+    now = run_controller(now, 2100 * 1000);
+    if (strcmp(CONTROLLER_get_profile_name(), "WII CLASSIC") != 0 || CONTROLLER_get_buttons() != a)
+        PROFILE_FAIL("classic: %s, buttons %04x\n", CONTROLLER_get_profile_name(), CONTROLLER_get_buttons());
+
+    // The ID is read at connect, not per poll
+    I2C_MODEL_get_stats(&bus);
+    uint32_t id_reads = bus.id_reads;
+    now = run_controller(now, 1000 * 1000);
+    I2C_MODEL_get_stats(&bus);
+    if (id_reads != 1 || bus.id_reads != id_reads)
+        PROFILE_FAIL("%u ID reads at connect, %u more while polling\n", id_reads, bus.id_reads - id_reads);
+
+    // Swapped for a Classic Controller Pro (or an SNES / NES Classic pad):
+    // Y and X play as B and A
+    I2C_MODEL_set_id(pro_id);
+    I2C_MODEL_set_buttons(0);
+    I2C_MODEL_forget_init();
+    now = run_controller(now, 1500 * 1000);
+    if (strcmp(CONTROLLER_get_profile_name(), "CLASSIC PRO") != 0 || CONTROLLER_get_buttons() != (a | b))
+        PROFILE_FAIL("pro: %s, buttons %04x\n", CONTROLLER_get_profile_name(), CONTROLLER_get_buttons());
+
+    // An ID nobody knows gets the Classic layout
+    I2C_MODEL_set_id(clone_id);
+    I2C_MODEL_set_buttons(b);
+    I2C_MODEL_forget_init();
+    now = run_controller(now, 1500 * 1000);
+    if (strcmp(CONTROLLER_get_profile_name(), "CLASSIC CLONE") != 0 || CONTROLLER_get_buttons() != b)
+        PROFILE_FAIL("clone: %s, buttons %04x\n", CONTROLLER_get_profile_name(), CONTROLLER_get_buttons());
+
+    // Original NES pad without room for its PIO program: refused, the I2C
+    // controller left as it was
+    NES_PAD_MODEL_reset();
+    NES_PAD_MODEL_set_room(false);
+    if (CONTROLLER_init_nes_pad(now, 0, 1, 2) || strcmp(CONTROLLER_get_profile_name(), "CLASSIC CLONE") != 0)
+        PROFILE_FAIL("NES pad taken without room for its reader\n");
+
+    // With room: every button on its own, then all of them, at the poll rate
+    NES_PAD_MODEL_set_room(true);
+    if (!CONTROLLER_init_nes_pad(now, 0, 1, 2))
+        PROFILE_FAIL("NES pad refused\n");
+    for (int button = 0; button <= BUTTON_COUNT; button++)
+    {
+        uint16_t pressed = button < BUTTON_COUNT ? 1 << button : (1 << BUTTON_HOME) - 1;
+        NES_PAD_MODEL_set_buttons(pressed);
+        now = run_controller(now, 50 * 1000);
+
+        // The pad has no HOME
+        pressed &= (1 << BUTTON_HOME) - 1;
+        if (!CONTROLLER_is_connected() || CONTROLLER_get_buttons() != pressed)
+            PROFILE_FAIL("NES pad: buttons %04x, expected %04x\n", CONTROLLER_get_buttons(), pressed);
+    }
+    uint32_t reads = NES_PAD_MODEL_get_reads();
+    now = run_controller(now, 1000 * 1000);
+    reads = NES_PAD_MODEL_get_reads() - reads;
+    if (strcmp(CONTROLLER_get_profile_name(), "NES PAD") != 0 || reads < CONTROLLER_DEFAULT_POLL_HZ - 1)
+        PROFILE_FAIL("NES pad: %s, %u reads in a second\n", CONTROLLER_get_profile_name(), reads);
+
+    printf("profiles: ok (classic, pro, clone, NES pad at %u reads/s)\n", reads);
+    return 0;
+}
+
+// Ages of the buttons at the game's joypad reads over two seconds, after one
+// to settle
+static int measure_latency(uint32_t* now_us, const char* name, uint32_t* p99_us)
+{
+    controller_latency_t before, after;
+
+    *now_us = run_controller(*now_us, 1000 * 1000);
+    CONTROLLER_get_latency(&before);
+    *now_us = run_controller(*now_us, 2000 * 1000);
+    CONTROLLER_get_latency(&after);
+
+    after.reads -= before.reads;
+    for (int i = 0; i < CONTROLLER_AGE_BUCKETS; i++)
+    {
+        after.histogram[i] -= before.histogram[i];
+    }
+    if (after.reads == 0)
+        CONTROLLER_FAIL("%s: no joypad reads seen\n", name);
+
+    *p99_us = CONTROLLER_age_percentile(&after, 99);
+    printf("controller latency %s: %u reads, button age p50 %u us, p99 %u us\n", name,
+           after.reads, CONTROLLER_age_percentile(&after, 50), *p99_us);
+    return 0;
+}
+
+#define TURBO_FAIL(...)         do { fprintf(stderr, "turbo: " __VA_ARGS__); return -1; } while (0)
+#define TURBO_CHECK_READS       (60)
+
+// Every mix of turbo rates and macros is compiled and played through the
+// joypad matrix: each setting's pattern must come out exact, read for read
+static int check_turbo(void)
+{
+    static const struct { const char* name; int on; int off; } rates[] =
+    {
+        { "OFF", 0, 0 }, { "30 HZ", 1, 1 }, { "20 HZ", 1, 2 }, { "15 HZ", 2, 2 }
+    };
+    static const struct { const char* name; int steps; uint16_t buttons[2]; } macros[] =
+    {
+        { "OFF", 1, { 0 } },
+        { "A+B", 1, { 0x003 } },
+        { "SOFT RESET", 1, { 0x00F } },
+        { "A/B ALT", 2, { 0x001, 0x002 } },
+    };
+    const int rate_count = sizeof(rates) / sizeof(rates[0]);
+    const int macro_count = sizeof(macros) / sizeof(macros[0]);
+    const uint16_t a_b = (1 << BUTTON_A) | (1 << BUTTON_B);
+    const uint16_t macro_up = (1 << BUTTON_MACRO) | (1 << BUTTON_UP);
+    uint16_t seen[TURBO_CHECK_READS];
+    int combinations = 0;
+
+    for (int m = 0; m < macro_count; m++)
+    {
+        for (int ra = 0; ra < rate_count; ra++)
+        {
+            for (int rb = 0; rb < rate_count; rb++)
+            {
+                if (strcmp(TURBO_get_rate_name(BUTTON_A), rates[ra].name) != 0
+                    || strcmp(TURBO_get_rate_name(BUTTON_B), rates[rb].name) != 0
+                    || strcmp(TURBO_get_macro_name(), macros[m].name) != 0)
+                    TURBO_FAIL("settings out of step: %s %s %s\n", TURBO_get_rate_name(BUTTON_A),
+                               TURBO_get_rate_name(BUTTON_B), TURBO_get_macro_name());
+                if (TURBO_get_table()->phases > TURBO_MAX_PHASES)
+                    TURBO_FAIL("%d reads per cycle\n", TURBO_get_table()->phases);
+
+                // A and B held from the first read: each on its own rate, held first
+                turbo_reads(a_b, TURBO_CHECK_READS, seen);
+                for (int n = 0; n < TURBO_CHECK_READS; n++)
+                {
+                    int period_a = rates[ra].on + rates[ra].off;
+                    int period_b = rates[rb].on + rates[rb].off;
+                    uint16_t expected = 0;
+                    expected |= !rates[ra].on || n % period_a < rates[ra].on ? 1 << BUTTON_A : 0;
+                    expected |= !rates[rb].on || n % period_b < rates[rb].on ? 1 << BUTTON_B : 0;
+                    if (seen[n] != expected)
+                        TURBO_FAIL("A %s, B %s: read %d saw %03x, expected %03x\n",
+                                   rates[ra].name, rates[rb].name, n, seen[n], expected);
+                }
+
+                // The macro button with the D-pad: the macro's steps on top of
+                // it, SOFT RESET's only for the reads the reset combo guard allows
+                turbo_reads(macro_up, TURBO_CHECK_READS, seen);
+                for (int n = 0; n < TURBO_CHECK_READS; n++)
+                {
+                    uint16_t expected = (1 << BUTTON_UP) | macros[m].buttons[n % macros[m].steps];
+                    if (macros[m].buttons[0] == 0x00F && n >= 2)
+                    {
+                        expected = 1 << BUTTON_UP;
+                    }
+                    if (seen[n] != expected)
+                        TURBO_FAIL("macro %s: read %d saw %03x, expected %03x\n", macros[m].name, n, seen[n], expected);
+                }
+
+                combinations++;
+                TURBO_change_rate(BUTTON_B, 1);
+            }
+            TURBO_change_rate(BUTTON_A, 1);
+        }
+        TURBO_change_macro(1);
+    }
+
+    // Every setting has wrapped back round to off; the macro wraps backwards too
+    TURBO_change_macro(-1);
+    TURBO_change_macro(1);
+    if (TURBO_get_table()->phases != 1 || TURBO_get_table()->turbo != 0)
+        TURBO_FAIL("not back to off\n");
+
+    printf("turbo: ok (%d settings, %d reads each)\n", combinations, TURBO_CHECK_READS);
+    return 0;
+}
+
+// Buttons pressed from the first read, set before each as the controller
+// tick would
+static void turbo_reads(uint16_t pressed, int reads, uint16_t* seen)
+{
+    JOYPAD_set_buttons(0);
+    for (int n = 0; n < reads; n++)
+    {
+        JOYPAD_set_buttons(pressed);
+        seen[n] = JOYPAD_MODEL_game_read();
+    }
+    JOYPAD_set_buttons(0);
+}
+
+// Records a pseudo-random game's worth of input, a change every dozen reads
+// or so, then plays it back: every read must see what it saw while
+// recording, turbo included.  Five minutes must fit whole, and of half an
+// hour the start, up to where the buffer filled.
+static int check_inputlog(void)
+{
+    static uint16_t sequence[INPUT_CHECK_READS];
+    static uint16_t recorded[INPUT_CHECK_READS];
+    inputlog_stats_t stats;
+    uint32_t seed = 1;
+    uint16_t held = 0;
+
+    for (int n = 0; n < INPUT_CHECK_READS; n++)
+    {
+        seed = seed * 1103515245 + 12345;
+        if ((seed >> 16) % 12 == 0)
+        {
+            held ^= 1 << ((seed >> 8) % 8);
+        }
+        sequence[n] = held;
+    }
+
+    // A minute with turbo A on: the log must hold the word each read saw
+    uint32_t reads, unused[BUTTON_COUNT];
+    TURBO_change_rate(BUTTON_A, 1);
+    record_input(sequence, INPUT_READS_PER_MINUTE, recorded);
+    TURBO_change_rate(BUTTON_A, -1);
+    if (replay_input(recorded, &reads, unused) != 0 || reads != INPUT_READS_PER_MINUTE)
+    {
+        fprintf(stderr, "inputlog: turbo recording did not replay\n");
+        return -1;
+    }
+
+    record_input(sequence, 5 * INPUT_READS_PER_MINUTE, recorded);
+    INPUTLOG_get_stats(&stats);
+    if (stats.full || stats.reads != 5 * INPUT_READS_PER_MINUTE)
+    {
+        fprintf(stderr, "inputlog: five minutes did not fit, only %u reads\n", stats.reads);
+        return -1;
+    }
+    uint32_t five_minute_bytes = stats.bytes;
+    uint32_t five_minute_changes = stats.changes;
+
+    if (round_trip_input() != 0 || replay_input(recorded, &reads, unused) != 0)
+        return -1;
+
+    // Too long for the buffer: it stops when full and replays from the start
+    record_input(sequence, INPUT_CHECK_READS, recorded);
+    INPUTLOG_get_stats(&stats);
+    if (!stats.full || stats.reads >= INPUT_CHECK_READS || round_trip_input() != 0
+        || replay_input(recorded, &reads, unused) != 0 || reads != stats.reads)
+    {
+        fprintf(stderr, "inputlog: full recording did not replay from its start\n");
+        return -1;
+    }
+    uint32_t full_reads = stats.reads;
+
+    // Across a mode change's reboot, once, and not once the buffer has changed
+    INPUTLOG_keep();
+    INPUTLOG_init();
+    if (replay_input(recorded, &reads, unused) != 0)
+    {
+        fprintf(stderr, "inputlog: kept recording did not replay\n");
+        return -1;
+    }
+    INPUTLOG_keep();
+    record_input(&sequence[1], 100, recorded);
+    INPUTLOG_init();
+    INPUTLOG_get_stats(&stats);
+    if (stats.reads != 0)
+    {
+        fprintf(stderr, "inputlog: overwritten recording was kept\n");
+        return -1;
+    }
+    INPUTLOG_keep();
+    INPUTLOG_init();
+    INPUTLOG_init();
+    INPUTLOG_get_stats(&stats);
+    if (stats.reads != 0)
+    {
+        fprintf(stderr, "inputlog: recording was kept twice\n");
+        return -1;
+    }
+
+    printf("inputlog: ok (5 minutes in %u bytes, %u changes; of 30 minutes the first %.1f kept)\n",
+           five_minute_bytes, five_minute_changes, (double)full_reads / INPUT_READS_PER_MINUTE);
+    return 0;
+}
+
+// Live buttons set before each read as the controller tick would; seen is
+// what each read got
+static void record_input(const uint16_t* sequence, uint32_t reads, uint16_t* seen)
+{
+    INPUTLOG_start_recording();
+    for (uint32_t n = 0; n < reads; n++)
+    {
+        JOYPAD_set_buttons(sequence[n]);
+        seen[n] = JOYPAD_MODEL_game_read();
+    }
+    INPUTLOG_stop();
+    JOYPAD_set_buttons(0);
+}
+
+// Whole recording through joypad.c, as gb_vga.c starts it and the game
+// reads it.  held counts the reads each button was seen held.
+static int replay_input(const uint16_t* expected, uint32_t* reads, uint32_t* held)
+{
+    uint16_t buttons;
+    uint32_t n = 0;
+
+    memset(held, 0, BUTTON_COUNT * sizeof(held[0]));
+    if (!INPUTLOG_start_replay(&buttons))
+    {
+        fprintf(stderr, "inputlog: nothing to replay\n");
+        return -1;
+    }
+    JOYPAD_replay_buttons(buttons);
+
+    do
+    {
+        uint16_t seen = JOYPAD_MODEL_game_read();
+        if (expected != NULL && seen != expected[n])
+        {
+            fprintf(stderr, "inputlog: read %u replayed %03x, recorded %03x\n", n, seen, expected[n]);
+            return -1;
+        }
+        for (int b = 0; b < BUTTON_COUNT; b++)
+        {
+            held[b] += (seen >> b) & 1;
+        }
+        n++;
+    } while (INPUTLOG_get_mode() == INPUTLOG_REPLAY);
+
+    *reads = n;
+    return 0;
+}
+
+// Export and import again, as when it comes off the board
+static int round_trip_input(void)
+{
+    input_export_length = 0;
+    INPUTLOG_export(export_write, NULL);
+    if (!INPUTLOG_import(input_export, input_export_length))
+    {
+        fprintf(stderr, "inputlog: exported recording does not import\n");
+        return -1;
+    }
+    return 0;
+}
+
+static void export_write(const uint8_t* data, size_t length, void* context)
+{
+    (void)context;
+    if (input_export_length + length <= sizeof(input_export))
+    {
+        memcpy(&input_export[input_export_length], data, length);
+    }
+    input_export_length += length;
+}
+
+// INPUTLOG lines as the board prints them
+static int replay_file(const char* path)
+{
+    static const char* const names[BUTTON_COUNT] =
+    {
+        "A", "B", "SELECT", "START", "UP", "DOWN", "LEFT", "RIGHT", "HOME", "MACRO"
+    };
+    char line[256];
+    FILE* f = fopen(path, "r");
+
+    if (f == NULL)
+    {
+        fprintf(stderr, "can't open %s\n", path);
+        return -1;
+    }
+
+    input_export_length = 0;
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        if (strncmp(line, "INPUTLOG END", 12) == 0)
+            break;
+        if (strncmp(line, "INPUTLOG ", 9) != 0)
+            continue;
+
+        unsigned int byte;
+        for (const char* hex = line + 9; sscanf(hex, "%2x", &byte) == 1; hex += 2)
+        {
+            uint8_t data = byte;
+            export_write(&data, 1, NULL);
+        }
+    }
+    fclose(f);
+
+    inputlog_stats_t stats;
+    uint32_t reads, held[BUTTON_COUNT];
+    if (!INPUTLOG_import(input_export, input_export_length))
+    {
+        fprintf(stderr, "%s: not an input recording\n", path);
+        return -1;
+    }
+    INPUTLOG_get_stats(&stats);
+    if (replay_input(NULL, &reads, held) != 0)
+        return -1;
+
+    printf("replay %s: %u reads (%.1f minutes), %u changes\n", path, reads,
+           (double)reads / INPUT_READS_PER_MINUTE, stats.changes);
+    for (int b = 0; b < BUTTON_COUNT; b++)
+    {
+        if (held[b])
+        {
+            printf("  %-6s held for %u reads\n", names[b], held[b]);
+        }
+    }
+    return 0;
+}
+
+// The board's repeating timer, CONTROLLER_TICK_US apart, and the game's
+// joypad reads in between: P14 selected twice per read, as most games do
+static uint32_t run_controller(uint32_t now_us, uint32_t for_us)
+{
+    for (uint32_t t = 0; t < for_us; t += CONTROLLER_TICK_US)
+    {
+        now_us += CONTROLLER_TICK_US;
+        while (joypad_period_us && (int32_t)(now_us - next_joypad_us) >= 0)
+        {
+            CONTROLLER_joypad_read(next_joypad_us);
+            CONTROLLER_joypad_read(next_joypad_us + 60);
+            next_joypad_us += joypad_period_us;
+        }
+        CONTROLLER_tick(now_us);
+    }
+    return now_us;
+}
+
+// Whole Scale3x pass, if the effect is on; returns its time in ns
+static uint64_t run_smoother(void)
+{
+    uint64_t start = now_ns();
+    while (RENDER_smooth_step())
+    {
+    }
+    return now_ns() - start;
+}
+
+// FNV-1a over the decoded pixels of the current mode
+static uint32_t image_hash(void)
+{
+    const render_mode_info_t *info = RENDER_get_mode_info(RENDER_get_mode());
+    uint32_t hash = 2166136261u;
+
+    for (int y = 0; y < info->height; y++)
+    {
+        for (int x = 0; x < info->width; x++)
+        {
+            hash = (hash ^ image[y][x]) * 16777619u;
+        }
+    }
+
+    return hash;
+}
+
+static void update_osd(void)
+{
+    char buff[32];
+    sprintf(buff, "COLOR SCHEME:% 5d", RENDER_get_scheme());
+    OSD_set_line_text(OSD_LINE_COLOR_SCHEME, buff);
+
+    sprintf(buff, "BORDER COLOR:% 5d", RENDER_get_border_color());
+    OSD_set_line_text(OSD_LINE_BORDER_COLOR, buff);
+
+    sprintf(buff, "EFFECTS:% 10d", RENDER_get_video_effect());
+    OSD_set_line_text(OSD_LINE_EFFECTS, buff);
+
+    sprintf(buff, "FX SCHEME:% 8d", RENDER_get_scanline_color());
+    OSD_set_line_text(OSD_LINE_FX_SCHEME, buff);
+
+    sprintf(buff, "MODE: %12s", RENDER_get_mode_info(RENDER_get_mode())->name);
+    OSD_set_line_text(OSD_LINE_OUTPUT_MODE, buff);
+
+    sprintf(buff, "OSD:%14s", RENDER_get_osd_translucent() ? "TRANSLUCENT" : "SOLID");
+    OSD_set_line_text(OSD_LINE_OSD_STYLE, buff);
+
+    sprintf(buff, "POLL RATE:%5d HZ", CONTROLLER_get_poll_rate());
+    OSD_set_line_text(OSD_LINE_POLL_RATE, buff);
+
+    sprintf(buff, "TURBO A:%10s", TURBO_get_rate_name(BUTTON_A));
+    OSD_set_line_text(OSD_LINE_TURBO_A, buff);
+
+    sprintf(buff, "TURBO B:%10s", TURBO_get_rate_name(BUTTON_B));
+    OSD_set_line_text(OSD_LINE_TURBO_B, buff);
+
+    sprintf(buff, "MACRO:%12s", TURBO_get_macro_name());
+    OSD_set_line_text(OSD_LINE_MACRO, buff);
+
+    static const char* const input_modes[INPUTLOG_MODE_COUNT] = { "LIVE", "RECORDING", "REPLAY" };
+    sprintf(buff, "INPUT: %11s", input_modes[INPUTLOG_get_mode()]);
+    OSD_set_line_text(OSD_LINE_INPUT, buff);
+
+    OSD_set_line_text(OSD_LINE_DIAGNOSTICS, "DIAGNOSTICS");
+    OSD_set_line_text(OSD_LINE_RESET_GAMEBOY, "RESET GAMEBOY");
+    OSD_set_line_text(OSD_LINE_EXIT, "EXIT");
+}
+
+static bool write_ppm(const char *path)
+{
+    FILE *f = fopen(path, "wb");
+    if (f == NULL)
+    {
+        perror(path);
+        return false;
+    }
+
+    const render_mode_info_t *info = RENDER_get_mode_info(RENDER_get_mode());
+
+    fprintf(f, "P6\n%d %d\n255\n", info->width, info->height);
+    for (int y = 0; y < info->height; y++)
+    {
+        for (int x = 0; x < info->width; x++)
+        {
+            uint8_t p = image[y][x];
+            uint8_t rgb[3] = {
+                ((p >> PICO_SCANVIDEO_PIXEL_RSHIFT) & 3) * 85,
+                ((p >> PICO_SCANVIDEO_PIXEL_GSHIFT) & 3) * 85,
+                ((p >> PICO_SCANVIDEO_PIXEL_BSHIFT) & 3) * 85,
+            };
+            fwrite(rgb, 1, sizeof(rgb), f);
+        }
+    }
+
+    fclose(f);
+    return true;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void benchmark(int frames)
+{
+    const render_mode_info_t *info = RENDER_get_mode_info(RENDER_get_mode());
+    bool rle = RENDER_get_rle_enabled();
+    render_stats_t before, after;
+    uint64_t total, worst_line, play_words;
+
+    // Whole output frames, new capture each time so only the moving bar changes
+    RENDER_get_stats(&before);
+    benchmark_frames(frames, &total, &worst_line, &play_words);
+    RENDER_get_stats(&after);
+
+    printf("%s RENDER_scanline: %.1f ns/line, worst %llu ns, %.1f us/frame\n", info->name,
+           (double)total / (frames * info->height), (unsigned long long)worst_line,
+           (double)total / frames / 1000.0);
+    printf("line cache: %u hits, %u misses, %u replicas\n",
+           after.line_cache_hits - before.line_cache_hits,
+           after.line_cache_misses - before.line_cache_misses,
+           after.line_cache_replicas - before.line_cache_replicas);
+    printf("lines by core: %u core 0, %u core 1\n",
+           after.core_lines[0] - before.core_lines[0],
+           after.core_lines[1] - before.core_lines[1]);
+
+    // The same frames with run-length encoding off and on
+    for (int pass = 0; pass < 2; pass++)
+    {
+        RENDER_set_rle_enabled(pass == 1);
+        benchmark_frames(frames, &total, &worst_line, &play_words);
+        printf("%-4s lines: %.1f buffer words/Game Boy line, %.1f ns/line, worst %llu ns\n",
+               pass ? "rle" : "raw", (double)play_words / (frames * PIXELS_Y * info->scale),
+               (double)total / (frames * info->height), (unsigned long long)worst_line);
+    }
+    RENDER_set_rle_enabled(rle);
+
+    if (RENDER_get_video_effect() == VIDEO_EFFECT_SCALE3X && info->scale == 3)
+    {
+        uint64_t smooth_ns = 0;
+        for (int f = 0; f < frames; f++)
+        {
+            capture_frame(f);
+            render_frame(false);
+            smooth_ns += run_smoother();
+        }
+        printf("scale3x pass: %.1f us/frame\n", (double)smooth_ns / frames / 1000.0);
+    }
+
+    // Composition alone, no cache: the current kernels against the old per-pixel loop
+    uint64_t kernel_ns = 0;
+    uint64_t reference_ns = 0;
+    for (int f = 0; f < frames; f++)
+    {
+        uint64_t start = now_ns();
+        for (int y = 0; y < PIXELS_Y; y++)
+        {
+            RENDER_compose_line(scanline, count_of(scanline), y);
+        }
+        kernel_ns += now_ns() - start;
+
+        start = now_ns();
+        for (int y = 0; y < PIXELS_Y; y++)
+        {
+            RENDER_reference_line(scanline, count_of(scanline), y);
+        }
+        reference_ns += now_ns() - start;
+    }
+
+    printf("compose: line kernels %.1f ns/line, per-pixel reference %.1f ns/line\n",
+           (double)kernel_ns / (frames * PIXELS_Y), (double)reference_ns / (frames * PIXELS_Y));
+
+    // Menu highlight moved with the OSD up: the frame after each move, and
+    // the Game Boy lines it has to compose again
+    bool osd_shown = OSD_is_enabled();
+    render_stats_t osd_before, osd_after;
+    if (!osd_shown)
+    {
+        OSD_toggle();
+        RENDER_invalidate();
+    }
+    render_frame(false);
+    RENDER_get_stats(&osd_before);
+    uint64_t osd_start = now_ns();
+    for (int f = 0; f < frames; f++)
+    {
+        OSD_change_line(1);
+        render_frame(false);
+    }
+    uint64_t osd_ns = now_ns() - osd_start;
+    RENDER_get_stats(&osd_after);
+    printf("osd line change: %.1f us/frame, %.1f Game Boy lines composed\n", (double)osd_ns / frames / 1000.0,
+           (double)(osd_after.line_cache_misses - osd_before.line_cache_misses) / frames);
+    if (!osd_shown)
+    {
+        OSD_toggle();
+        RENDER_invalidate();
+    }
+
+    framestore_stats_t fs;
+    FRAMESTORE_get_stats(&fs);
+    printf("frame store: %u published, %u displayed, %u repeated, %u dropped, %u torn\n",
+           fs.published, fs.displayed, fs.repeated, fs.dropped, fs.torn);
+}
+
+// Times RENDER_scanline() over whole output frames and totals the buffer words
+// of the lines that carry Game Boy pixels
+static void benchmark_frames(int frames, uint64_t *total_ns, uint64_t *worst_ns, uint64_t *play_words)
+{
+    const render_mode_info_t *info = RENDER_get_mode_info(RENDER_get_mode());
+    int play_top = (info->height - PIXELS_Y*info->scale)/2;
+
+    *total_ns = 0;
+    *worst_ns = 0;
+    *play_words = 0;
+
+    for (int f = 0; f < frames; f++)
+    {
+        capture_frame(f);
+        for (int line = 0; line < info->height; line++)
+        {
+            // Both cores taking turns, as they do when core 0 is idle
+            host_core_num = line & 1;
+
+            uint64_t start = now_ns();
+            int32_t words = RENDER_scanline(scanline, count_of(scanline), line, output_frame);
+            uint64_t elapsed = now_ns() - start;
+
+            *total_ns += elapsed;
+            *worst_ns = elapsed > *worst_ns ? elapsed : *worst_ns;
+            if (line >= play_top && line < play_top + PIXELS_Y*info->scale)
+            {
+                *play_words += words;
+            }
+        }
+        output_frame++;
+        run_smoother();
+    }
+
+    host_core_num = 1;
+}
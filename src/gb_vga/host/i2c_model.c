@@ -0,0 +1,249 @@
+#include "i2c_model.h"
+#include "i2c_bus.h"
+#include "controller.h"
+#include <string.h>
+
+#define REPORT_BYTES            (8)
+#define ID_REGISTER             (0xFA)
+#define ID_BYTES                (6)
+
+typedef struct
+{
+    uint8_t byte;
+    uint8_t bit;
+    uint8_t button;
+} model_button_t;
+
+// Wii Classic report layout, kept apart from controller_profile.c so
+// the two check each other
+static const model_button_t report_buttons[] =
+{
+    { 4, 7, BUTTON_RIGHT },
+    { 4, 6, BUTTON_DOWN },
+    { 4, 4, BUTTON_SELECT },    // minus
+    { 4, 3, BUTTON_HOME },
+    { 4, 2, BUTTON_START },     // plus
+    { 4, 1, BUTTON_MACRO },     // R
+    { 5, 6, BUTTON_B },
+    { 5, 4, BUTTON_A },
+    { 5, 1, BUTTON_LEFT },
+    { 5, 0, BUTTON_UP },
+};
+
+// Sticks centred, triggers released
+static const uint8_t idle_sticks[4] = { 0x5F, 0xDF, 0x8F, 0x00 };
+
+static const uint8_t classic_id[ID_BYTES] = { 0x00, 0x00, 0xA4, 0x20, 0x01, 0x01 };
+
+static bool present;
+static bool stuck;
+static int latency;
+static uint16_t pressed;
+static uint8_t extra_byte;
+static uint8_t extra_bits;
+static uint8_t id[ID_BYTES];
+static uint8_t next_id[ID_BYTES];
+static bool encryption_off;     // 0xF0 = 0x55 seen
+static bool initialised;        // ... then 0xFB = 0x00
+static uint8_t pointer;
+static i2c_model_stats_t stats;
+
+// The transfer in flight
+static i2c_bus_status_t bus_state;
+static int busy_polls;
+static uint8_t write_data[I2C_BUS_MAX_WRITE];
+static size_t write_length;
+static uint8_t* read_data;
+static size_t read_length;
+
+//**********************************************************************************************
+// PRIVATE FUNCTION PROTOTYPES
+//**********************************************************************************************
+static void begin_transfer(void);
+static void complete_write(void);
+static void complete_read(void);
+
+//**********************************************************************************************
+// PUBLIC FUNCTIONS
+//**********************************************************************************************
+void I2C_MODEL_reset(void)
+{
+    present = true;
+    stuck = false;
+    latency = 0;
+    pressed = 0;
+    extra_bits = 0;
+    memcpy(id, classic_id, sizeof(id));
+    memcpy(next_id, classic_id, sizeof(next_id));
+    encryption_off = false;
+    initialised = false;
+    pointer = 0;
+    memset(&stats, 0, sizeof(stats));
+    bus_state = I2C_BUS_IDLE;
+}
+
+void I2C_MODEL_set_present(bool is_present)
+{
+    present = is_present;
+    if (!present)
+    {
+        I2C_MODEL_forget_init();
+    }
+}
+
+void I2C_MODEL_set_buttons(uint16_t buttons)
+{
+    pressed = buttons;
+}
+
+void I2C_MODEL_set_extra_bits(uint8_t byte, uint8_t bits)
+{
+    extra_byte = byte;
+    extra_bits = bits;
+}
+
+void I2C_MODEL_set_id(const uint8_t new_id[6])
+{
+    memcpy(next_id, new_id, sizeof(next_id));
+}
+
+void I2C_MODEL_set_latency(int polls)
+{
+    latency = polls;
+}
+
+void I2C_MODEL_set_stuck(bool is_stuck)
+{
+    stuck = is_stuck;
+}
+
+void I2C_MODEL_forget_init(void)
+{
+    encryption_off = false;
+    initialised = false;
+}
+
+bool I2C_MODEL_is_initialised(void)
+{
+    return initialised;
+}
+
+void I2C_MODEL_get_stats(i2c_model_stats_t* out)
+{
+    *out = stats;
+}
+
+void I2C_BUS_init(uint8_t address, uint32_t baudrate)
+{
+    (void)address;
+    (void)baudrate;
+    bus_state = I2C_BUS_IDLE;
+}
+
+void I2C_BUS_write(const uint8_t* data, size_t length)
+{
+    begin_transfer();
+    memcpy(write_data, data, length);
+    write_length = length;
+    read_data = NULL;
+}
+
+void I2C_BUS_read(uint8_t* data, size_t length)
+{
+    begin_transfer();
+    read_data = data;
+    read_length = length;
+}
+
+i2c_bus_status_t I2C_BUS_status(void)
+{
+    if (bus_state != I2C_BUS_BUSY)
+        return bus_state;
+
+    if (stuck || busy_polls-- > 0)
+        return I2C_BUS_BUSY;
+
+    bus_state = I2C_BUS_IDLE;
+    if (!present)
+    {
+        stats.naks++;
+        return I2C_BUS_ERROR;
+    }
+
+    if (read_data)
+    {
+        complete_read();
+    }
+    else
+    {
+        complete_write();
+    }
+    return I2C_BUS_DONE;
+}
+
+void I2C_BUS_abort(void)
+{
+    if (bus_state == I2C_BUS_BUSY)
+    {
+        stats.aborts++;
+    }
+    bus_state = I2C_BUS_IDLE;
+}
+
+//**********************************************************************************************
+// PRIVATE FUNCTIONS
+//**********************************************************************************************
+static void begin_transfer(void)
+{
+    bus_state = I2C_BUS_BUSY;
+    busy_polls = latency;
+}
+
+static void complete_write(void)
+{
+    stats.writes++;
+
+    if (write_length == 2 && write_data[0] == 0xF0 && write_data[1] == 0x55)
+    {
+        encryption_off = true;
+    }
+    else if (write_length == 2 && write_data[0] == 0xFB && write_data[1] == 0x00)
+    {
+        initialised = encryption_off;
+        memcpy(id, next_id, sizeof(id));
+    }
+    pointer = write_data[0];
+}
+
+static void complete_read(void)
+{
+    uint8_t report[REPORT_BYTES];
+
+    stats.reads++;
+
+    memset(report, 0xFF, sizeof(report));
+    if (initialised && pointer == 0x00)
+    {
+        memcpy(report, idle_sticks, sizeof(idle_sticks));
+        for (size_t i = 0; i < sizeof(report_buttons)/sizeof(report_buttons[0]); i++)
+        {
+            const model_button_t* b = &report_buttons[i];
+            if (pressed & (1 << b->button))
+            {
+                report[b->byte] &= ~(1 << b->bit);
+            }
+        }
+        report[extra_byte] &= ~extra_bits;
+    }
+    else if (initialised && pointer == ID_REGISTER)
+    {
+        stats.id_reads++;
+        memcpy(report, id, sizeof(id));
+    }
+
+    for (size_t i = 0; i < read_length; i++)
+    {
+        read_data[i] = i < REPORT_BYTES ? report[i] : 0xFF;
+    }
+    pointer += read_length;
+}
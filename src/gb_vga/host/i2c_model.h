@@ -0,0 +1,49 @@
+#ifndef I2C_MODEL_H
+#define I2C_MODEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Host-side stand-in for i2c_bus.c with a Wii Classic controller on the
+// other end: it has to be sent the unencrypted init sequence before it
+// answers with button data or its ID, and reads back 0xFF until then.
+// Transfers stay busy for a configurable number of I2C_BUS_status() calls.
+typedef struct
+{
+    uint32_t writes;
+    uint32_t reads;
+    uint32_t id_reads;          // reads from register 0xFA
+    uint32_t naks;
+    uint32_t aborts;
+} i2c_model_stats_t;
+
+// Present, not yet initialised, nothing held, transfers done on first poll,
+// Wii Classic Controller ID
+void I2C_MODEL_reset(void);
+
+// An absent controller NAKs its address
+void I2C_MODEL_set_present(bool present);
+
+// Held buttons, bit per controller_button_t
+void I2C_MODEL_set_buttons(uint16_t pressed);
+
+// Report bits held that no controller_button_t names, e.g. Y and X: set
+// bits are cleared in that report byte
+void I2C_MODEL_set_extra_bits(uint8_t byte, uint8_t bits);
+
+// Answered from register 0xFA; takes effect at the next handshake
+void I2C_MODEL_set_id(const uint8_t id[6]);
+
+// I2C_BUS_status() calls a transfer stays busy for
+void I2C_MODEL_set_latency(int polls);
+
+// A target holding SCL low: transfers stay busy until aborted
+void I2C_MODEL_set_stuck(bool stuck);
+
+// Controller reset or swapped: needs the init sequence again
+void I2C_MODEL_forget_init(void);
+
+bool I2C_MODEL_is_initialised(void);
+void I2C_MODEL_get_stats(i2c_model_stats_t* stats);
+
+#endif // I2C_MODEL_H
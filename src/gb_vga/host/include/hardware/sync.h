@@ -0,0 +1,48 @@
+#ifndef HOST_HARDWARE_SYNC_H
+#define HOST_HARDWARE_SYNC_H
+
+#include "pico.h"
+
+static inline void __dmb(void)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+// The harness is single threaded; locks only need to be balanced
+typedef volatile uint32_t spin_lock_t;
+
+static inline int spin_lock_claim_unused(bool required)
+{
+    (void)required;
+    return 0;
+}
+
+static inline spin_lock_t* spin_lock_init(unsigned lock_num)
+{
+    static spin_lock_t locks[32];
+    return &locks[lock_num];
+}
+
+static inline uint32_t spin_lock_blocking(spin_lock_t* lock)
+{
+    *lock = 1;
+    return 0;
+}
+
+static inline void spin_unlock(spin_lock_t* lock, uint32_t saved_irq)
+{
+    (void)saved_irq;
+    *lock = 0;
+}
+
+static inline uint32_t save_and_disable_interrupts(void)
+{
+    return 0;
+}
+
+static inline void restore_interrupts(uint32_t status)
+{
+    (void)status;
+}
+
+#endif // HOST_HARDWARE_SYNC_H
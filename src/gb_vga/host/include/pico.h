@@ -0,0 +1,27 @@
+#ifndef HOST_PICO_H
+#define HOST_PICO_H
+
+// Host stand-in for the bits of pico.h the portable modules use
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define __not_in_flash_func(func_name)      func_name
+#define __time_critical_func(func_name)     func_name
+#define __scratch_x(group)
+#define __scratch_y(group)
+#define __uninitialized_ram(group)          group
+
+#define count_of(a) (sizeof(a)/sizeof((a)[0]))
+
+static inline void tight_loop_contents(void) {}
+
+// Core the harness is pretending to be, so per-core counters can be checked
+extern unsigned host_core_num;
+static inline unsigned get_core_num(void)
+{
+    return host_core_num;
+}
+
+#endif // HOST_PICO_H
@@ -0,0 +1,18 @@
+#ifndef HOST_PICO_SCANVIDEO_H
+#define HOST_PICO_SCANVIDEO_H
+
+// Host stand-in for pico/scanvideo.h: pixel layout and buffer size only,
+// matching the definitions gb_vga's CMakeLists.txt passes to the real one
+
+#include "pico.h"
+
+#define PICO_SCANVIDEO_PIXEL_RSHIFT                 (4)
+#define PICO_SCANVIDEO_PIXEL_GSHIFT                 (2)
+#define PICO_SCANVIDEO_PIXEL_BSHIFT                 (0)
+#define PICO_SCANVIDEO_PIXEL_RCOUNT                 (2)
+#define PICO_SCANVIDEO_PIXEL_GCOUNT                 (2)
+#define PICO_SCANVIDEO_PIXEL_BCOUNT                 (2)
+
+#define PICO_SCANVIDEO_MAX_SCANLINE_BUFFER_WORDS    (500)
+
+#endif // HOST_PICO_SCANVIDEO_H
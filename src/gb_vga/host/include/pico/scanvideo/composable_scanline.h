@@ -0,0 +1,15 @@
+#ifndef HOST_PICO_SCANVIDEO_COMPOSABLE_SCANLINE_H
+#define HOST_PICO_SCANVIDEO_COMPOSABLE_SCANLINE_H
+
+// Host stand-in for the composable scanline tokens.  On the board these are
+// entry points into the scanvideo PIO program; here they only need to be
+// distinct, since the host decoder includes this same header.
+
+#define COMPOSABLE_COLOR_RUN        (0)
+#define COMPOSABLE_EOL_ALIGN        (1)
+#define COMPOSABLE_RAW_RUN          (2)
+#define COMPOSABLE_RAW_1P           (3)
+#define COMPOSABLE_EOL_SKIP_ALIGN   (4)
+#define COMPOSABLE_RAW_2P           (5)
+
+#endif // HOST_PICO_SCANVIDEO_COMPOSABLE_SCANLINE_H
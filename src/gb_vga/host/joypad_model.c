@@ -0,0 +1,72 @@
+#include "joypad_model.h"
+#include "joypad_pio.h"
+#include "capture.h"
+#include "controller.h"
+
+// Out pins from the out base (GPIO 21): P13, P12, -, -, -, P11, P10
+static const uint8_t line_bits[4] = { 6, 5, 1, 0 };
+
+static const controller_button_t dpad[4] = { BUTTON_RIGHT, BUTTON_LEFT, BUTTON_UP, BUTTON_DOWN };
+static const controller_button_t buttons[4] = { BUTTON_A, BUTTON_B, BUTTON_SELECT, BUTTON_START };
+
+static uint32_t word;
+static joypad_edge_handler_t start_handler;
+static joypad_edge_handler_t end_handler;
+static uint32_t now_us = 0;
+
+//**********************************************************************************************
+// PUBLIC FUNCTIONS
+//**********************************************************************************************
+void JOYPAD_PIO_init(uint8_t p14_pin, uint8_t out_base, uint32_t out_mask, uint32_t first_word,
+                     joypad_edge_handler_t read_start, joypad_edge_handler_t read_end)
+{
+    (void)p14_pin;
+    (void)out_base;
+    (void)out_mask;
+    word = first_word;
+    start_handler = read_start;
+    end_handler = read_end;
+}
+
+void JOYPAD_PIO_put(uint32_t new_word)
+{
+    word = new_word;
+}
+
+// Keep in step with joypad.pio
+uint8_t JOYPAD_MODEL_lines(bool p14, bool p15)
+{
+    uint32_t osr = word;                    // pull noblock
+    uint32_t y = (p15 << 1) | p14;          // in pins, 2 / mov y, isr
+
+    while (y-- != 0)                        // jmp y-- skip
+    {
+        osr >>= 8;                          // out null, 8
+    }
+    uint8_t pins = osr & 0x7F;              // out pins, 7
+
+    uint8_t nibble = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        nibble |= ((pins >> line_bits[i]) & 1) << i;
+    }
+    return nibble;
+}
+
+uint16_t JOYPAD_MODEL_game_read(void)
+{
+    now_us += CAPTURE_FRAME_US;
+
+    start_handler(now_us);
+    uint8_t dpad_lines = JOYPAD_MODEL_lines(false, true);
+    uint8_t buttons_lines = JOYPAD_MODEL_lines(true, false);
+    end_handler(now_us + 60);
+
+    uint16_t pressed = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        pressed |= !(dpad_lines & (1 << i)) << dpad[i];
+        pressed |= !(buttons_lines & (1 << i)) << buttons[i];
+    }
+    return pressed;
+}
@@ -0,0 +1,20 @@
+#ifndef JOYPAD_MODEL_H
+#define JOYPAD_MODEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Host-side stand-in for joypad_pio.c: a model of joypad.pio answering from
+// the last word joypad.c put up, with the board's pins, and a game reading
+// it.  Bit n of a line nibble is P1n, low while held, as the Game Boy reads
+// it from the P1 register.
+
+// One pass of the responder with the select lines at these levels
+uint8_t JOYPAD_MODEL_lines(bool p14, bool p15);
+
+// A game's joypad read a Game Boy frame after the last: the start edge,
+// D-pad with P14 low, then buttons with P15 low, then the end edge, each
+// through joypad.c's handlers.  Decoded back into a controller_button_t mask.
+uint16_t JOYPAD_MODEL_game_read(void);
+
+#endif // JOYPAD_MODEL_H
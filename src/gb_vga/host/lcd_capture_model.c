@@ -0,0 +1,226 @@
+#include "lcd_capture_model.h"
+#include "capture.h"
+#include "framestore.h"
+#include "frame_layout.h"
+#include <string.h>
+
+typedef enum
+{
+    OP_WAIT_PIN = 0,        // wait <a> pin <b>
+    OP_MOV_X_Y,             // mov x, y
+    OP_MOV_OSR_REV_PINS,    // mov osr, ::pins
+    OP_OUT_NULL,            // out null, <a>
+    OP_IN_OSR,              // in osr, <a>
+    OP_JMP_X_DEC,           // jmp x-- <a>
+    OP_IRQ                  // irq nowait <a>
+} lcd_model_op_t;
+
+typedef struct
+{
+    uint8_t op;
+    uint8_t a;
+    uint8_t b;
+} lcd_model_instr_t;
+
+// Keep in step with lcd_capture.pio
+static const lcd_model_instr_t capture_program[] =
+{
+    { OP_WAIT_PIN, 0, 4 },          // frame:
+    { OP_WAIT_PIN, 1, 4 },
+    { OP_MOV_X_Y, 0, 0 },           // .wrap_target
+    { OP_WAIT_PIN, 1, 3 },
+    { OP_WAIT_PIN, 0, 3 },
+    { OP_MOV_OSR_REV_PINS, 0, 0 },
+    { OP_OUT_NULL, 30, 0 },
+    { OP_IN_OSR, 2, 0 },
+    { OP_WAIT_PIN, 1, 2 },          // pixel:
+    { OP_WAIT_PIN, 0, 2 },
+    { OP_MOV_OSR_REV_PINS, 0, 0 },
+    { OP_OUT_NULL, 30, 0 },
+    { OP_IN_OSR, 2, 0 },
+    { OP_JMP_X_DEC, 8, 0 },         // .wrap
+};
+#define CAPTURE_OFFSET_FRAME    (0)
+#define CAPTURE_WRAP_TARGET     (2)
+#define CAPTURE_WRAP            (13)
+
+static const lcd_model_instr_t vsync_program[] =
+{
+    { OP_WAIT_PIN, 0, 0 },          // .wrap_target
+    { OP_WAIT_PIN, 1, 0 },
+    { OP_IRQ, 0, 0 },               // .wrap
+};
+#define VSYNC_WRAP_TARGET       (0)
+#define VSYNC_WRAP              (2)
+
+// An SM never runs more than a handful of instructions between two waits;
+// this only guards against a broken program table.
+#define MAX_STEPS_PER_SAMPLE    (64)
+
+#define FRAME_WORDS             (FRAME_BYTES/sizeof(uint32_t))
+
+// Model last sampled, for CAPTURE_get_frame_count()
+static const lcd_capture_model_t* current = NULL;
+
+//**********************************************************************************************
+// PRIVATE FUNCTION PROTOTYPES
+//**********************************************************************************************
+static void shift_in(lcd_capture_model_t* model, lcd_model_sm_t* sm, uint32_t data, uint8_t bits);
+static void run_sm(lcd_capture_model_t* model, lcd_model_sm_t* sm, const lcd_model_instr_t* program,
+                   uint8_t wrap_target, uint8_t wrap, uint32_t pins);
+static void restart_capture(lcd_capture_model_t* model);
+static void dma_push(lcd_capture_model_t* model, uint32_t word);
+static void vsync_irq(lcd_capture_model_t* model);
+static uint32_t reverse_bits(uint32_t value);
+
+//**********************************************************************************************
+// PUBLIC FUNCTIONS
+//**********************************************************************************************
+void LCD_MODEL_init(lcd_capture_model_t* model)
+{
+    memset(model, 0, sizeof(*model));
+
+    model->capture_armed = true;
+
+    model->capture_sm.pc = CAPTURE_OFFSET_FRAME;
+    model->capture_sm.y = PIXELS_X - 2;
+}
+
+void LCD_MODEL_sample(lcd_capture_model_t* model, uint8_t pins)
+{
+    current = model;
+
+    // The VSYNC SM reads from its own in_base, four pins up
+    run_sm(model, &model->vsync_sm, vsync_program, VSYNC_WRAP_TARGET, VSYNC_WRAP, pins >> 4);
+    run_sm(model, &model->capture_sm, capture_program, CAPTURE_WRAP_TARGET, CAPTURE_WRAP, pins);
+}
+
+// As capture.c's, for joypad.c
+uint32_t CAPTURE_get_frame_count(void)
+{
+    return current != NULL ? current->frame_count : 0;
+}
+
+//**********************************************************************************************
+// PRIVATE FUNCTIONS
+//**********************************************************************************************
+static void shift_in(lcd_capture_model_t* model, lcd_model_sm_t* sm, uint32_t data, uint8_t bits)
+{
+    // Shift right, autopush at 32
+    sm->isr = (sm->isr >> bits) | (data << (32 - bits));
+    sm->isr_count += bits;
+    if (sm->isr_count >= 32)
+    {
+        uint32_t word = sm->isr;
+        sm->isr = 0;
+        sm->isr_count = 0;
+        dma_push(model, word);
+    }
+}
+
+static void run_sm(lcd_capture_model_t* model, lcd_model_sm_t* sm, const lcd_model_instr_t* program,
+                   uint8_t wrap_target, uint8_t wrap, uint32_t pins)
+{
+    for (int step = 0; step < MAX_STEPS_PER_SAMPLE; step++)
+    {
+        const lcd_model_instr_t* instr = &program[sm->pc];
+        uint8_t next_pc = sm->pc == wrap ? wrap_target : sm->pc + 1;
+
+        switch (instr->op)
+        {
+            case OP_WAIT_PIN:
+                if (((pins >> instr->b) & 1) != instr->a)
+                    return;     // stalled until the next sample
+                break;
+            case OP_MOV_X_Y:
+                sm->x = sm->y;
+                break;
+            case OP_MOV_OSR_REV_PINS:
+                sm->osr = reverse_bits(pins);
+                break;
+            case OP_OUT_NULL:
+                sm->osr >>= instr->a;
+                break;
+            case OP_IN_OSR:
+                shift_in(model, sm, sm->osr & ((1u << instr->a) - 1), instr->a);
+                break;
+            case OP_JMP_X_DEC:
+                if (sm->x-- != 0)
+                    next_pc = instr->a;
+                break;
+            case OP_IRQ:
+                vsync_irq(model);
+                break;
+        }
+
+        // A DMA completion may have restarted this SM under our feet
+        if (sm == &model->capture_sm && sm->pc != (uint8_t)(instr - program))
+            continue;
+
+        sm->pc = next_pc;
+    }
+}
+
+// Mirrors restart_capture() in capture.c
+static void restart_capture(lcd_capture_model_t* model)
+{
+    model->capture_sm.isr = 0;
+    model->capture_sm.isr_count = 0;
+    model->capture_sm.pc = CAPTURE_OFFSET_FRAME;
+    model->dma_index = 0;
+}
+
+// Mirrors dma_handler() in capture.c
+static void dma_push(lcd_capture_model_t* model, uint32_t word)
+{
+    if (model->dma_index >= FRAME_WORDS)
+        return;
+
+    uint8_t* p = &FRAMESTORE_get_write_buffer()[model->dma_index * sizeof(uint32_t)];
+    p[0] = word;
+    p[1] = word >> 8;
+    p[2] = word >> 16;
+    p[3] = word >> 24;
+
+    if (++model->dma_index == FRAME_WORDS)
+    {
+        FRAMESTORE_publish();
+        restart_capture(model);
+        model->frame_count++;
+        model->last_lines = PIXELS_Y;
+        model->capture_armed = true;
+    }
+}
+
+// Mirrors vsync_handler() in capture.c
+static void vsync_irq(lcd_capture_model_t* model)
+{
+    if (model->capture_armed)
+    {
+        model->capture_armed = false;
+    }
+    else
+    {
+        uint32_t lines = model->dma_index / (FRAME_LINE_BYTES/sizeof(uint32_t));
+
+        restart_capture(model);
+        model->capture_armed = true;
+        model->resync_count++;
+        model->last_lines = lines;
+        if (lines < PIXELS_Y)
+        {
+            model->short_frames++;
+        }
+    }
+}
+
+static uint32_t reverse_bits(uint32_t value)
+{
+    uint32_t result = 0;
+    for (int i = 0; i < 32; i++)
+    {
+        result = (result << 1) | (value & 1);
+        value >>= 1;
+    }
+    return result;
+}
@@ -0,0 +1,46 @@
+#ifndef LCD_CAPTURE_MODEL_H
+#define LCD_CAPTURE_MODEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Host-side model of lcd_capture.pio plus the DMA / IRQ glue in capture.c.
+// Completed frames are published to the frame store, same as on the board,
+// and counted by CAPTURE_get_frame_count().
+// Feed it one pin sample at a time, e.g. from a logic analyser recording.
+// Bit n of a sample is the level of pin DATA_0 + n, which on the board is
+// (gpio_get_all() >> DATA_0_PIN) & 0x1F.
+#define LCD_SAMPLE_DATA_0       (1u << 0)
+#define LCD_SAMPLE_DATA_1       (1u << 1)
+#define LCD_SAMPLE_PIXEL_CLOCK  (1u << 2)
+#define LCD_SAMPLE_HSYNC        (1u << 3)
+#define LCD_SAMPLE_VSYNC        (1u << 4)
+
+typedef struct
+{
+    uint8_t pc;
+    uint32_t x;
+    uint32_t y;
+    uint32_t isr;
+    uint8_t isr_count;
+    uint32_t osr;
+} lcd_model_sm_t;
+
+typedef struct
+{
+    lcd_model_sm_t capture_sm;
+    lcd_model_sm_t vsync_sm;
+
+    uint32_t dma_index;
+
+    bool capture_armed;
+    uint32_t frame_count;
+    uint32_t resync_count;
+    uint32_t short_frames;
+    uint32_t last_lines;
+} lcd_capture_model_t;
+
+void LCD_MODEL_init(lcd_capture_model_t* model);
+void LCD_MODEL_sample(lcd_capture_model_t* model, uint8_t pins);
+
+#endif // LCD_CAPTURE_MODEL_H
@@ -0,0 +1,76 @@
+#include "nes_pad_model.h"
+#include "nes_pad.h"
+#include "controller.h"
+
+// Shift order of the pad's 4021, kept apart from the table in
+// controller_profile.c so the two check each other
+static const controller_button_t shift_order[8] =
+{
+    BUTTON_A, BUTTON_B, BUTTON_SELECT, BUTTON_START,
+    BUTTON_UP, BUTTON_DOWN, BUTTON_LEFT, BUTTON_RIGHT
+};
+
+static bool has_room;
+static uint16_t pressed;
+static uint32_t reads;
+static bool pending;
+
+//**********************************************************************************************
+// PUBLIC FUNCTIONS
+//**********************************************************************************************
+void NES_PAD_MODEL_reset(void)
+{
+    has_room = true;
+    pressed = 0;
+    reads = 0;
+    pending = false;
+}
+
+void NES_PAD_MODEL_set_room(bool room)
+{
+    has_room = room;
+}
+
+void NES_PAD_MODEL_set_buttons(uint16_t buttons)
+{
+    pressed = buttons;
+}
+
+uint32_t NES_PAD_MODEL_get_reads(void)
+{
+    return reads;
+}
+
+bool NES_PAD_init(uint8_t latch_pin, uint8_t clock_pin, uint8_t data_pin)
+{
+    (void)latch_pin;
+    (void)clock_pin;
+    (void)data_pin;
+    pending = false;
+    return has_room;
+}
+
+void NES_PAD_start(void)
+{
+    reads++;
+    pending = true;
+}
+
+bool NES_PAD_result(uint8_t* report)
+{
+    if (!pending)
+        return false;
+
+    // Data line low while held, first bit shifted lowest
+    uint8_t bits = 0xFF;
+    for (int i = 0; i < 8; i++)
+    {
+        if (pressed & (1 << shift_order[i]))
+        {
+            bits &= ~(1 << i);
+        }
+    }
+    *report = bits;
+    pending = false;
+    return true;
+}
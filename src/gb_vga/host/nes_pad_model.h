@@ -0,0 +1,20 @@
+#ifndef NES_PAD_MODEL_H
+#define NES_PAD_MODEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Host-side stand-in for nes_pad.c with an original NES pad's 4021 on the
+// other end.  A read's result is there by the next NES_PAD_result() call.
+void NES_PAD_MODEL_reset(void);
+
+// No room for the reader's PIO program: NES_PAD_init() fails
+void NES_PAD_MODEL_set_room(bool room);
+
+// Held buttons, bit per controller_button_t
+void NES_PAD_MODEL_set_buttons(uint16_t pressed);
+
+// Reads started since the reset
+uint32_t NES_PAD_MODEL_get_reads(void);
+
+#endif // NES_PAD_MODEL_H
@@ -0,0 +1,70 @@
+#include "scanline_decode.h"
+#include "pico/scanvideo/composable_scanline.h"
+
+#define MIN_RUN 3
+
+int DECODE_scanline(const uint32_t *buf, int32_t words, uint8_t *pixels, int max_pixels)
+{
+    const uint16_t *p16 = (const uint16_t *) buf;
+    const uint16_t *end = p16 + words * 2;
+    int count = 0;
+
+    while (p16 < end)
+    {
+        uint16_t token = *p16++;
+        int run;
+
+        switch (token)
+        {
+            case COMPOSABLE_COLOR_RUN:
+                if (end - p16 < 2)
+                    return -1;
+                uint16_t color = *p16++;
+                run = *p16++ + MIN_RUN;
+                if (count + run > max_pixels)
+                    return -1;
+                for (int i = 0; i < run; i++)
+                {
+                    pixels[count++] = color;
+                }
+                break;
+
+            case COMPOSABLE_RAW_RUN:
+                // | RAW_RUN | p0 | count - 3 | p1 | ... |
+                if (end - p16 < 2)
+                    return -1;
+                uint16_t first = *p16++;
+                run = *p16++ + MIN_RUN;
+                if (count + run > max_pixels || end - p16 < run - 1)
+                    return -1;
+                pixels[count++] = first;
+                for (int i = 1; i < run; i++)
+                {
+                    pixels[count++] = *p16++;
+                }
+                break;
+
+            case COMPOSABLE_RAW_1P:
+            case COMPOSABLE_RAW_2P:
+                run = token == COMPOSABLE_RAW_1P ? 1 : 2;
+                if (count + run > max_pixels || end - p16 < run)
+                    return -1;
+                for (int i = 0; i < run; i++)
+                {
+                    pixels[count++] = *p16++;
+                }
+                break;
+
+            case COMPOSABLE_EOL_ALIGN:
+            case COMPOSABLE_EOL_SKIP_ALIGN:
+                return count;
+
+            default:
+                return -1;
+        }
+    }
+
+    // The word count can cut off a trailing EOL_ALIGN at an odd halfword,
+    // in which case the line simply ends with the data
+    return count;
+}
@@ -0,0 +1,11 @@
+#ifndef SCANLINE_DECODE_H
+#define SCANLINE_DECODE_H
+
+#include <stdint.h>
+
+// Expands a composable scanline token stream, as handed to scanvideo, into
+// one RGB222 pixel per byte.  Returns the number of pixels the line would
+// put on screen, or -1 if the stream is malformed or overruns max_pixels.
+int DECODE_scanline(const uint32_t *buf, int32_t words, uint8_t *pixels, int max_pixels);
+
+#endif // SCANLINE_DECODE_H
@@ -0,0 +1,124 @@
+#include "i2c_bus.h"
+#include "hardware/i2c.h"
+#include "hardware/dma.h"
+
+#define I2C_BUS_INSTANCE    i2c0
+
+// The I2C block's 16 entry TX FIFO takes a whole transfer's commands at
+// once; a DMA channel drains the RX FIFO into the caller's buffer.  Neither
+// ever waits on the bus.
+static uint dma_channel;
+static dma_channel_config dma_config;
+static i2c_bus_status_t state = I2C_BUS_IDLE;
+static bool reading = false;
+
+//**********************************************************************************************
+// PRIVATE FUNCTION PROTOTYPES
+//**********************************************************************************************
+static void begin_transfer(i2c_hw_t* hw);
+
+//**********************************************************************************************
+// PUBLIC FUNCTIONS
+//**********************************************************************************************
+void I2C_BUS_init(uint8_t address, uint32_t baudrate)
+{
+    i2c_hw_t* hw = i2c_get_hw(I2C_BUS_INSTANCE);
+
+    i2c_init(I2C_BUS_INSTANCE, baudrate);
+    hw->enable = 0;
+    hw->tar = address;
+    hw->dma_cr = I2C_IC_DMA_CR_RDMAE_BITS;
+    hw->enable = 1;
+
+    dma_channel = dma_claim_unused_channel(true);
+    dma_config = dma_channel_get_default_config(dma_channel);
+    channel_config_set_transfer_data_size(&dma_config, DMA_SIZE_8);
+    channel_config_set_read_increment(&dma_config, false);
+    channel_config_set_write_increment(&dma_config, true);
+    channel_config_set_dreq(&dma_config, i2c_get_dreq(I2C_BUS_INSTANCE, false));
+}
+
+void I2C_BUS_write(const uint8_t* data, size_t length)
+{
+    i2c_hw_t* hw = i2c_get_hw(I2C_BUS_INSTANCE);
+
+    begin_transfer(hw);
+    reading = false;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        hw->data_cmd = data[i] | (i == length - 1 ? I2C_IC_DATA_CMD_STOP_BITS : 0);
+    }
+}
+
+void I2C_BUS_read(uint8_t* data, size_t length)
+{
+    i2c_hw_t* hw = i2c_get_hw(I2C_BUS_INSTANCE);
+
+    begin_transfer(hw);
+    reading = true;
+
+    dma_channel_configure(dma_channel, &dma_config, data, &hw->data_cmd, length, true);
+    for (size_t i = 0; i < length; i++)
+    {
+        hw->data_cmd = I2C_IC_DATA_CMD_CMD_BITS | (i == length - 1 ? I2C_IC_DATA_CMD_STOP_BITS : 0);
+    }
+}
+
+i2c_bus_status_t I2C_BUS_status(void)
+{
+    if (state != I2C_BUS_BUSY)
+        return state;
+
+    i2c_hw_t* hw = i2c_get_hw(I2C_BUS_INSTANCE);
+    uint32_t raw = hw->raw_intr_stat;
+
+    if (raw & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS)
+    {
+        // The block flushes the TX FIFO and sends STOP by itself
+        (void)hw->clr_tx_abrt;
+        if (reading)
+        {
+            dma_channel_abort(dma_channel);
+        }
+        state = I2C_BUS_IDLE;
+        return I2C_BUS_ERROR;
+    }
+
+    if ((raw & I2C_IC_RAW_INTR_STAT_STOP_DET_BITS) && !(reading && dma_channel_is_busy(dma_channel)))
+    {
+        (void)hw->clr_stop_det;
+        state = I2C_BUS_IDLE;
+        return I2C_BUS_DONE;
+    }
+
+    return I2C_BUS_BUSY;
+}
+
+void I2C_BUS_abort(void)
+{
+    i2c_hw_t* hw = i2c_get_hw(I2C_BUS_INSTANCE);
+
+    if (reading)
+    {
+        dma_channel_abort(dma_channel);
+    }
+    hw->enable |= I2C_IC_ENABLE_ABORT_BITS;
+    state = I2C_BUS_IDLE;
+}
+
+//**********************************************************************************************
+// PRIVATE FUNCTIONS
+//**********************************************************************************************
+static void begin_transfer(i2c_hw_t* hw)
+{
+    // Leftovers of an aborted transfer
+    (void)hw->clr_tx_abrt;
+    (void)hw->clr_stop_det;
+    while (hw->rxflr > 0)
+    {
+        (void)hw->data_cmd;
+    }
+
+    state = I2C_BUS_BUSY;
+}
@@ -0,0 +1,36 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Asynchronous transfers to a single I2C target, for code that runs from a
+// timer interrupt and may never wait on the bus.  One transfer at a time:
+// start it, then poll I2C_BUS_status() until it is no longer busy.  Writes
+// and reads both end with a STOP.
+#define I2C_BUS_MAX_WRITE       (8)
+
+typedef enum
+{
+    I2C_BUS_IDLE = 0,       // no transfer, or its result was already collected
+    I2C_BUS_BUSY,
+    I2C_BUS_DONE,
+    I2C_BUS_ERROR           // NACK or lost arbitration; the bus is ready again
+} i2c_bus_status_t;
+
+void I2C_BUS_init(uint8_t address, uint32_t baudrate);
+
+// length at most I2C_BUS_MAX_WRITE; data is copied before returning
+void I2C_BUS_write(const uint8_t* data, size_t length);
+
+// data must stay valid until the transfer is no longer busy
+void I2C_BUS_read(uint8_t* data, size_t length);
+
+// DONE and ERROR are reported once, then the bus reads IDLE
+i2c_bus_status_t I2C_BUS_status(void);
+
+// Drops a transfer that is taking too long, e.g. a target holding SCL low
+void I2C_BUS_abort(void);
+
+#endif // I2C_BUS_H
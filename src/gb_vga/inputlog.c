@@ -0,0 +1,396 @@
+#include "inputlog.h"
+#include "pico.h"
+#include "hardware/sync.h"
+#include <stddef.h>
+#include <string.h>
+
+#define MAX_CHANGE_BYTES    (4*5)       // four 32-bit varints
+#define EXPORT_MAGIC        "GBIL"
+#define KEPT_MAGIC          (0x4B454550)    // 'KEEP'
+
+typedef struct
+{
+    uint32_t read;                      // since the start of the recording
+    uint32_t frame;
+    uint32_t time_us;
+    uint16_t buttons;
+} inputlog_point_t;
+
+// What INPUTLOG_keep() leaves for after a reboot, with the buffer
+typedef struct
+{
+    uint32_t magic;
+    uint32_t used;
+    uint32_t reads;
+    uint32_t changes;
+    uint32_t full;
+    inputlog_point_t first;
+    inputlog_point_t last;
+    uint32_t check;                     // over the fields above and the buffer bytes in use
+} inputlog_kept_t;
+
+static uint8_t __uninitialized_ram(buffer)[INPUTLOG_BYTES];
+static inputlog_kept_t __uninitialized_ram(kept);
+static uint32_t used = 0;
+static inputlog_point_t first;          // read 0; the changes follow on from it
+static inputlog_point_t last;           // most recent change, or first
+static uint32_t reads = 0;
+static uint32_t changes = 0;
+static bool full = false;               // no room for the last change, so no more reads
+static volatile inputlog_mode_t mode = INPUTLOG_LIVE;
+
+// Replay
+static uint32_t cursor;                 // next change to decode
+static uint32_t cursor_left;
+static inputlog_point_t replay_at;      // read being played
+static inputlog_point_t upcoming;       // next change, while has_upcoming
+static bool has_upcoming;
+static uint32_t replayed;
+
+//**********************************************************************************************
+// PRIVATE FUNCTION PROTOTYPES
+//**********************************************************************************************
+static void record(uint16_t shown, uint32_t frame, uint32_t now_us);
+static bool replay(uint16_t* next);
+static bool append_change(const inputlog_point_t* from, const inputlog_point_t* to);
+static bool decode_change(uint32_t* index, uint32_t* left, const inputlog_point_t* from, inputlog_point_t* to);
+static bool log_varint(uint32_t* index, uint32_t* left, uint32_t* value);
+static bool buffer_varint(const uint8_t* data, size_t length, size_t* index, uint32_t* value);
+static int put_varint(uint8_t* out, uint32_t value);
+static uint32_t kept_check(void);
+
+//**********************************************************************************************
+// PUBLIC FUNCTIONS
+//**********************************************************************************************
+void INPUTLOG_start_recording(void)
+{
+    uint32_t irq = save_and_disable_interrupts();
+
+    used = 0;
+    reads = 0;
+    changes = 0;
+    full = false;
+    memset(&first, 0, sizeof(first));
+    last = first;
+    mode = INPUTLOG_RECORD;
+
+    restore_interrupts(irq);
+}
+
+bool INPUTLOG_start_replay(uint16_t* first_buttons)
+{
+    uint32_t irq = save_and_disable_interrupts();
+
+    mode = INPUTLOG_LIVE;
+    bool have = reads > 0;
+    if (have)
+    {
+        cursor = 0;
+        cursor_left = used;
+        replay_at = first;
+        has_upcoming = decode_change(&cursor, &cursor_left, &replay_at, &upcoming);
+        replayed = 0;
+        *first_buttons = first.buttons;
+        mode = INPUTLOG_REPLAY;
+    }
+
+    restore_interrupts(irq);
+    return have;
+}
+
+void INPUTLOG_stop(void)
+{
+    mode = INPUTLOG_LIVE;
+}
+
+inputlog_mode_t INPUTLOG_get_mode(void)
+{
+    return mode;
+}
+
+bool INPUTLOG_joypad_read(uint16_t shown, uint32_t frame, uint32_t now_us, uint16_t* next)
+{
+    switch (mode)
+    {
+        case INPUTLOG_RECORD:
+            record(shown, frame, now_us);
+            return false;
+        case INPUTLOG_REPLAY:
+            return replay(next);
+        default:
+            return false;
+    }
+}
+
+void INPUTLOG_keep(void)
+{
+    mode = INPUTLOG_LIVE;
+
+    kept.used = used;
+    kept.reads = reads;
+    kept.changes = changes;
+    kept.full = full;
+    kept.first = first;
+    kept.last = last;
+    kept.check = kept_check();
+    kept.magic = KEPT_MAGIC;
+}
+
+void INPUTLOG_init(void)
+{
+    mode = INPUTLOG_LIVE;
+
+    if (kept.magic == KEPT_MAGIC && kept.used <= INPUTLOG_BYTES && kept.check == kept_check())
+    {
+        used = kept.used;
+        reads = kept.reads;
+        changes = kept.changes;
+        full = kept.full != 0;
+        first = kept.first;
+        last = kept.last;
+    }
+    else
+    {
+        used = 0;
+        reads = 0;
+        changes = 0;
+        full = false;
+        memset(&first, 0, sizeof(first));
+        last = first;
+    }
+
+    // Once only: the buffer changes with the next recording
+    kept.magic = 0;
+}
+
+void INPUTLOG_export(inputlog_write_t write, void* context)
+{
+    uint8_t header[5 + 5*5];
+    int n = 0;
+
+    memcpy(header, EXPORT_MAGIC, 4);
+    n += 4;
+    header[n++] = INPUTLOG_VERSION;
+    n += put_varint(&header[n], reads);
+    n += put_varint(&header[n], first.frame);
+    n += put_varint(&header[n], first.time_us);
+    n += put_varint(&header[n], first.buttons);
+    n += put_varint(&header[n], used);
+    write(header, n, context);
+    if (used > 0)
+    {
+        write(buffer, used, context);
+    }
+}
+
+bool INPUTLOG_import(const uint8_t* data, size_t length)
+{
+    uint32_t total, frame, time_us, buttons, bytes;
+    size_t index = 5;
+
+    if (length < 5 || memcmp(data, EXPORT_MAGIC, 4) != 0 || data[4] != INPUTLOG_VERSION)
+        return false;
+
+    if (!buffer_varint(data, length, &index, &total)
+        || !buffer_varint(data, length, &index, &frame)
+        || !buffer_varint(data, length, &index, &time_us)
+        || !buffer_varint(data, length, &index, &buttons)
+        || !buffer_varint(data, length, &index, &bytes)
+        || bytes > INPUTLOG_BYTES || bytes > length - index)
+        return false;
+
+    uint32_t irq = save_and_disable_interrupts();
+
+    mode = INPUTLOG_LIVE;
+    memcpy(buffer, &data[index], bytes);
+    used = bytes;
+    reads = total;
+    full = false;
+    first.read = 0;
+    first.frame = frame;
+    first.time_us = time_us;
+    first.buttons = buttons;
+
+    // Count the changes, and find the last one in case of a bad stream
+    uint32_t at = 0, left = used;
+    inputlog_point_t point = first;
+    changes = 0;
+    while (decode_change(&at, &left, &point, &point))
+    {
+        changes++;
+    }
+    last = point;
+
+    bool valid = left == 0 && last.read < reads;
+    if (!valid)
+    {
+        reads = 0;
+        used = 0;
+        changes = 0;
+    }
+
+    restore_interrupts(irq);
+    return valid;
+}
+
+void INPUTLOG_get_stats(inputlog_stats_t* out)
+{
+    uint32_t irq = save_and_disable_interrupts();
+
+    out->reads = reads;
+    out->changes = changes;
+    out->full = full;
+    out->bytes = used;
+    out->replayed = replayed;
+
+    restore_interrupts(irq);
+}
+
+//**********************************************************************************************
+// PRIVATE FUNCTIONS
+//**********************************************************************************************
+static void record(uint16_t shown, uint32_t frame, uint32_t now_us)
+{
+    inputlog_point_t point = { reads, frame, now_us, shown };
+
+    if (full)
+        return;
+
+    if (reads == 0)
+    {
+        first = point;
+        last = point;
+    }
+    else if (shown != last.buttons)
+    {
+        // Out of room: the recording ends before this read
+        if (!append_change(&last, &point))
+        {
+            full = true;
+            return;
+        }
+        last = point;
+    }
+    reads++;
+}
+
+// Buttons for the read after the one starting now
+static bool replay(uint16_t* next)
+{
+    uint32_t read = replay_at.read + 1;
+
+    if (read >= reads)
+    {
+        mode = INPUTLOG_LIVE;
+        return false;
+    }
+
+    if (has_upcoming && upcoming.read == read)
+    {
+        replay_at = upcoming;
+        has_upcoming = decode_change(&cursor, &cursor_left, &replay_at, &upcoming);
+    }
+    else
+    {
+        replay_at.read = read;
+    }
+
+    replayed++;
+    *next = replay_at.buttons;
+    return true;
+}
+
+static bool append_change(const inputlog_point_t* from, const inputlog_point_t* to)
+{
+    uint8_t change[MAX_CHANGE_BYTES];
+    int n = 0;
+
+    n += put_varint(&change[n], to->read - from->read);
+    n += put_varint(&change[n], to->frame - from->frame);
+    n += put_varint(&change[n], to->time_us - from->time_us);
+    n += put_varint(&change[n], to->buttons);
+
+    if (INPUTLOG_BYTES - used < (uint32_t)n)
+        return false;
+
+    memcpy(&buffer[used], change, n);
+    used += n;
+    changes++;
+    return true;
+}
+
+static bool decode_change(uint32_t* index, uint32_t* left, const inputlog_point_t* from, inputlog_point_t* to)
+{
+    uint32_t read, frame, time_us, buttons;
+
+    if (!log_varint(index, left, &read)
+        || !log_varint(index, left, &frame)
+        || !log_varint(index, left, &time_us)
+        || !log_varint(index, left, &buttons))
+        return false;
+
+    to->read = from->read + read;
+    to->frame = from->frame + frame;
+    to->time_us = from->time_us + time_us;
+    to->buttons = buttons;
+    return true;
+}
+
+static bool log_varint(uint32_t* index, uint32_t* left, uint32_t* value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 35 && *left > 0; shift += 7)
+    {
+        uint8_t byte = buffer[(*index)++];
+        (*left)--;
+
+        *value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+static bool buffer_varint(const uint8_t* data, size_t length, size_t* index, uint32_t* value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 35 && *index < length; shift += 7)
+    {
+        uint8_t byte = data[(*index)++];
+
+        *value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+static int put_varint(uint8_t* out, uint32_t value)
+{
+    int n = 0;
+    do
+    {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        out[n++] = byte | (value ? 0x80 : 0);
+    } while (value);
+    return n;
+}
+
+// FNV-1a over the kept fields before check, then the buffer bytes in use
+static uint32_t kept_check(void)
+{
+    const uint8_t* fields = (const uint8_t*)&kept.used;
+    size_t length = offsetof(inputlog_kept_t, check) - offsetof(inputlog_kept_t, used);
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ fields[i]) * 16777619u;
+    }
+    for (uint32_t i = 0; i < kept.used && i < INPUTLOG_BYTES; i++)
+    {
+        hash = (hash ^ buffer[i]) * 16777619u;
+    }
+    return hash;
+}
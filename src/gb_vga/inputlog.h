@@ -0,0 +1,68 @@
+#ifndef INPUTLOG_H
+#define INPUTLOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Buttons the Game Boy was shown at each joypad read, recorded into an
+// in-RAM buffer and played back read for read.  Only changes are stored: the
+// reads, frames and microseconds since the previous change, then the new
+// button mask, each as a LEB128 varint.  Typically 5-7 bytes per change, so
+// the buffer holds several minutes of play.  Once full the recording stops
+// there, keeping its start: a replay begins from a Game Boy reset.
+//
+// Export format, for the host harness (gb_vga_host -r):
+//   "GBIL", version byte, then varints: reads, first frame, first time (us),
+//   first buttons, change bytes; then the change bytes themselves
+#define INPUTLOG_BYTES          (16384)
+#define INPUTLOG_VERSION        (1)
+
+typedef enum
+{
+    INPUTLOG_LIVE = 0,
+    INPUTLOG_RECORD,
+    INPUTLOG_REPLAY,
+    INPUTLOG_MODE_COUNT
+} inputlog_mode_t;
+
+typedef struct
+{
+    uint32_t reads;             // joypad reads in the recording
+    uint32_t changes;           // button changes in the buffer
+    bool full;                  // ran out of buffer and stopped recording
+    uint32_t bytes;             // buffer bytes in use
+    uint32_t replayed;          // reads played back so far
+} inputlog_stats_t;
+
+typedef void (*inputlog_write_t)(const uint8_t* data, size_t length, void* context);
+
+// Both clear the game's view back to read 0: reset the Game Boy first so
+// the reads line up
+void INPUTLOG_start_recording(void);
+
+// false if there is nothing to play; first is what read 0 should see
+bool INPUTLOG_start_replay(uint16_t* first);
+
+void INPUTLOG_stop(void);
+inputlog_mode_t INPUTLOG_get_mode(void);
+
+// At the end of each joypad read, with what it was shown.  Recording, it is
+// logged.  Replaying, returns true with next holding the buttons for the
+// following read; false once the recording has run out, which drops back
+// to live.
+bool INPUTLOG_joypad_read(uint16_t shown, uint32_t frame, uint32_t now_us, uint16_t* next);
+
+// A mode change reboots through the watchdog.  Before it, INPUTLOG_keep()
+// stops and leaves the recording, whose buffer is not cleared at boot, where
+// INPUTLOG_init() picks it up again if it is intact.
+void INPUTLOG_keep(void);
+void INPUTLOG_init(void);
+
+// Not while recording
+void INPUTLOG_export(inputlog_write_t write, void* context);
+bool INPUTLOG_import(const uint8_t* data, size_t length);
+
+void INPUTLOG_get_stats(inputlog_stats_t* stats);
+
+#endif // INPUTLOG_H
@@ -0,0 +1,234 @@
+#include "joypad.h"
+#include "joypad_pio.h"
+#include "controller.h"
+#include "capture.h"
+#include "inputlog.h"
+#include "turbo.h"
+#include "pico.h"
+#include "hardware/sync.h"
+
+// P15:P14 as the state machine sees them
+#define SELECT_BOTH         (0)
+#define SELECT_BUTTONS      (1)         // P15 low
+#define SELECT_DPAD         (2)         // P14 low
+#define SELECT_NONE         (3)
+#define SELECT_STATES       (4)
+
+// Reads the full reset combo is let through for before it is held back
+#define RESET_COMBO_READS   (2)
+#define RESET_COMBO         ((1 << BUTTON_A) | (1 << BUTTON_B) | (1 << BUTTON_SELECT) | (1 << BUTTON_START))
+
+// A to RIGHT; HOME is not wired to the Game Boy
+#define MATRIX_BUTTONS      ((1 << BUTTON_HOME) - 1)
+
+static uint8_t line_bits[4];            // P10-P13 -> bit in an out pin pattern
+static uint32_t last_word = 0;
+
+// A pin word per read of the turbo cycle, stepped through at the end of each
+// read.  Rebuilt by the controller tick, which runs on the same core at the
+// same priority as the read handlers, so neither interrupts the other.
+static uint32_t phase_words[TURBO_MAX_PHASES];
+static uint16_t phase_buttons[TURBO_MAX_PHASES];
+static int phases = 1;
+static int phase = 0;
+
+// What the words were last built from
+static uint16_t live = 0;
+static const turbo_table_t* live_table = NULL;
+static uint16_t live_held_back = 0;
+
+static volatile uint32_t reads = 0;
+static bool step_due = false;           // set at the first edge of a read, for its end
+static bool combo_held = false;
+static uint32_t combo_reads = 0;        // read count when the combo was first held
+
+//**********************************************************************************************
+// PRIVATE FUNCTION PROTOTYPES
+//**********************************************************************************************
+static uint8_t line_pattern(uint16_t pressed, const controller_button_t lines[4]);
+static uint16_t reset_combo_guard(uint16_t pressed);
+static void show(const uint16_t* buttons, int count, int first_phase);
+static uint32_t pin_word(uint16_t pressed);
+static void put_word(uint32_t word);
+static void read_start(uint32_t now_us);
+static void read_end(uint32_t now_us);
+
+//**********************************************************************************************
+// PUBLIC FUNCTIONS
+//**********************************************************************************************
+void JOYPAD_init(uint8_t p14_pin, const uint8_t line_pins[4])
+{
+    uint8_t out_base = line_pins[0];
+    for (int i = 1; i < 4; i++)
+    {
+        out_base = line_pins[i] < out_base ? line_pins[i] : out_base;
+    }
+
+    uint32_t out_mask = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        line_bits[i] = line_pins[i] - out_base;
+        out_mask |= 1u << line_pins[i];
+    }
+
+    // Nothing held until the first word
+    phase_buttons[0] = 0;
+    phase_words[0] = pin_word(0);
+    phases = 1;
+    phase = 0;
+    last_word = phase_words[0];
+
+    JOYPAD_PIO_init(p14_pin, out_base, out_mask, last_word, read_start, read_end);
+}
+
+void JOYPAD_set_buttons(uint16_t pressed)
+{
+    const turbo_table_t* table = TURBO_get_table();
+    uint16_t expanded[TURBO_MAX_PHASES];
+    int count = TURBO_expand(table, pressed, expanded);
+
+    uint16_t any = 0;
+    for (int i = 0; i < count; i++)
+    {
+        any |= expanded[i];
+    }
+    uint16_t held_back = reset_combo_guard(any);
+
+    // Called every tick: the words only change with the buttons or settings
+    if (pressed == live && table == live_table && held_back == live_held_back)
+        return;
+
+    // A turbo or macro button just pressed restarts the cycle, where it is held
+    uint16_t restart = pressed & ~live & (table->turbo | (1 << BUTTON_MACRO));
+    live = pressed;
+    live_table = table;
+    live_held_back = held_back;
+
+    for (int i = 0; i < count; i++)
+    {
+        expanded[i] &= ~held_back;
+    }
+    show(expanded, count, restart || phase >= count ? 0 : phase);
+}
+
+void JOYPAD_replay_buttons(uint16_t pressed)
+{
+    // From the main loop, unlike the tick
+    uint32_t irq = save_and_disable_interrupts();
+    show(&pressed, 1, 0);
+    live_table = NULL;
+    restore_interrupts(irq);
+}
+
+uint32_t JOYPAD_get_read_count(void)
+{
+    return reads;
+}
+
+//**********************************************************************************************
+// PRIVATE FUNCTIONS
+//**********************************************************************************************
+// Words for each read of the cycle, showing the first_phase one now
+static void show(const uint16_t* buttons, int count, int first_phase)
+{
+    for (int i = 0; i < count; i++)
+    {
+        phase_buttons[i] = buttons[i] & MATRIX_BUTTONS;
+        phase_words[i] = pin_word(phase_buttons[i]);
+    }
+    phases = count;
+    phase = first_phase;
+    put_word(phase_words[phase]);
+}
+
+// A pattern per select state, both selected pulling a line low for either
+// button
+static uint32_t pin_word(uint16_t pressed)
+{
+    static const controller_button_t dpad[4] = { BUTTON_RIGHT, BUTTON_LEFT, BUTTON_UP, BUTTON_DOWN };
+    static const controller_button_t buttons[4] = { BUTTON_A, BUTTON_B, BUTTON_SELECT, BUTTON_START };
+
+    uint8_t dpad_pattern = line_pattern(pressed, dpad);
+    uint8_t buttons_pattern = line_pattern(pressed, buttons);
+    uint8_t none_pattern = line_pattern(0, dpad);
+
+    uint32_t word = 0;
+    word |= (uint32_t)(dpad_pattern & buttons_pattern) << (SELECT_BOTH * 8);
+    word |= (uint32_t)buttons_pattern << (SELECT_BUTTONS * 8);
+    word |= (uint32_t)dpad_pattern << (SELECT_DPAD * 8);
+    word |= (uint32_t)none_pattern << (SELECT_NONE * 8);
+    return word;
+}
+
+static void put_word(uint32_t word)
+{
+    if (word != last_word)
+    {
+        JOYPAD_PIO_put(word);
+        last_word = word;
+    }
+}
+
+// Out pin levels for one select state: low while held
+static uint8_t line_pattern(uint16_t pressed, const controller_button_t lines[4])
+{
+    uint8_t pattern = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        if (!(pressed & (1 << lines[i])))
+        {
+            pattern |= 1 << line_bits[i];
+        }
+    }
+    return pattern;
+}
+
+// Prevent Tetris in-game reset lockup: A+B+Select+Start is let through for
+// a couple of reads, so soft reset still works, then released until let
+// go.  Returns the buttons to hold back.
+static uint16_t reset_combo_guard(uint16_t pressed)
+{
+    if ((pressed & RESET_COMBO) != RESET_COMBO)
+    {
+        combo_held = false;
+        return 0;
+    }
+
+    if (!combo_held)
+    {
+        combo_held = true;
+        combo_reads = reads;
+    }
+
+    return reads - combo_reads >= RESET_COMBO_READS ? RESET_COMBO : 0;
+}
+
+// P14 fell: the game is reading the word put up at the end of the last read
+static void __not_in_flash_func(read_start)(uint32_t now_us)
+{
+    reads++;
+
+    // Turbo and macros step once per read, not per edge
+    if (CONTROLLER_joypad_read(now_us))
+    {
+        step_due = true;
+    }
+}
+
+// Both select lines high again: the read is over, so what it saw is logged
+// and the word for the next goes up now, well clear of it
+static void __not_in_flash_func(read_end)(uint32_t now_us)
+{
+    uint16_t next;
+
+    if (INPUTLOG_joypad_read(phase_buttons[phase], CAPTURE_get_frame_count(), now_us, &next))
+    {
+        show(&next, 1, 0);
+    }
+    else if (step_due && phases > 1)
+    {
+        phase = phase + 1 < phases ? phase + 1 : 0;
+        put_word(phase_words[phase]);
+    }
+    step_due = false;
+}
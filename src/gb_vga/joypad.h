@@ -0,0 +1,28 @@
+#ifndef JOYPAD_H
+#define JOYPAD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// The Game Boy's joypad matrix, answered by a PIO state machine instead of
+// GPIO interrupts.  p14_pin is the first of two consecutive inputs: P14
+// (D-pad select), P15 (button select).  line_pins are the outputs P10-P13,
+// all within 7 pins of the lowest.  Interrupts for the start and end of each
+// joypad read are taken on the calling core (joypad_pio.h); they also drive
+// inputlog.h.
+void JOYPAD_init(uint8_t p14_pin, const uint8_t line_pins[4]);
+
+// Bit per controller_button_t, set while held.  Turbo and macros
+// (turbo.h) are applied here, into a word per read of their cycle.  Safe to
+// call often; the words are only rebuilt when the buttons or settings
+// change, and the state machine only gets one when the pins would change.
+void JOYPAD_set_buttons(uint16_t pressed);
+
+// Shown as is, without turbo or the reset combo guard: for replaying what
+// a recording shows.  Live buttons should not be set meanwhile.
+void JOYPAD_replay_buttons(uint16_t pressed);
+
+// Joypad reads seen since boot
+uint32_t JOYPAD_get_read_count(void);
+
+#endif // JOYPAD_H
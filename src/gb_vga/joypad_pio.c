@@ -0,0 +1,73 @@
+#include "joypad_pio.h"
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "hardware/irq.h"
+#include "joypad.pio.h"
+
+// Shares pio1 with the LCD capture, which uses IRQ flag 0 and PIO1_IRQ_0
+#define JOYPAD_PIO          pio1
+#define JOYPAD_PIO_IRQ      PIO1_IRQ_1
+#define READ_START_FLAG     (1)
+#define READ_END_FLAG       (2)
+
+static uint joypad_sm;
+static joypad_edge_handler_t start_handler;
+static joypad_edge_handler_t end_handler;
+
+//**********************************************************************************************
+// PRIVATE FUNCTION PROTOTYPES
+//**********************************************************************************************
+static void select_handler(void);
+
+//**********************************************************************************************
+// PUBLIC FUNCTIONS
+//**********************************************************************************************
+void JOYPAD_PIO_init(uint8_t p14_pin, uint8_t out_base, uint32_t out_mask, uint32_t word,
+                     joypad_edge_handler_t read_start, joypad_edge_handler_t read_end)
+{
+    uint offset = pio_add_program(JOYPAD_PIO, &joypad_program);
+    joypad_sm = pio_claim_unused_sm(JOYPAD_PIO, true);
+    joypad_program_init(JOYPAD_PIO, joypad_sm, offset, p14_pin, out_base, out_mask);
+
+    uint select_offset = pio_add_program(JOYPAD_PIO, &joypad_select_program);
+    uint select_sm = pio_claim_unused_sm(JOYPAD_PIO, true);
+    joypad_select_program_init(JOYPAD_PIO, select_sm, select_offset, p14_pin);
+
+    start_handler = read_start;
+    end_handler = read_end;
+    pio_set_irq1_source_enabled(JOYPAD_PIO, pis_interrupt1, true);
+    pio_set_irq1_source_enabled(JOYPAD_PIO, pis_interrupt2, true);
+    irq_set_exclusive_handler(JOYPAD_PIO_IRQ, select_handler);
+    irq_set_enabled(JOYPAD_PIO_IRQ, true);
+
+    pio_sm_put(JOYPAD_PIO, joypad_sm, word);
+    pio_sm_set_enabled(JOYPAD_PIO, select_sm, true);
+    pio_sm_set_enabled(JOYPAD_PIO, joypad_sm, true);
+}
+
+void JOYPAD_PIO_put(uint32_t word)
+{
+    // The SM empties the FIFO on every pass, so this never waits
+    pio_sm_put(JOYPAD_PIO, joypad_sm, word);
+}
+
+//**********************************************************************************************
+// PRIVATE FUNCTIONS
+//**********************************************************************************************
+// Both edges share the interrupt.  With both pending the end goes first:
+// a game that never deselects both lines ends one read as it starts the next.
+static void __not_in_flash_func(select_handler)(void)
+{
+    uint32_t now = time_us_32();
+
+    if (pio_interrupt_get(JOYPAD_PIO, READ_END_FLAG))
+    {
+        pio_interrupt_clear(JOYPAD_PIO, READ_END_FLAG);
+        end_handler(now);
+    }
+    if (pio_interrupt_get(JOYPAD_PIO, READ_START_FLAG))
+    {
+        pio_interrupt_clear(JOYPAD_PIO, READ_START_FLAG);
+        start_handler(now);
+    }
+}
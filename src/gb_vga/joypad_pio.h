@@ -0,0 +1,24 @@
+#ifndef JOYPAD_PIO_H
+#define JOYPAD_PIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// The state machines behind joypad.h.  One answers the joypad matrix from a
+// word of four 8-bit out pin patterns, one per select state P15:P14 (0 both
+// low to 3 neither), and keeps driving the last word it was given.  The
+// other watches the select lines: a read starts when P14 falls and ends
+// once P14 and P15 are both high again.  Each edge calls its handler on
+// the core that called JOYPAD_PIO_init(), with the time.
+typedef void (*joypad_edge_handler_t)(uint32_t now_us);
+
+// p14_pin is the first of two consecutive inputs, P14 then P15.  The out
+// pins are the out_mask ones within 7 pins of out_base; word is driven
+// until the first JOYPAD_PIO_put().
+void JOYPAD_PIO_init(uint8_t p14_pin, uint8_t out_base, uint32_t out_mask, uint32_t word,
+                     joypad_edge_handler_t read_start, joypad_edge_handler_t read_end);
+
+// Driven within ~10 cycles
+void JOYPAD_PIO_put(uint32_t word);
+
+#endif // JOYPAD_PIO_H
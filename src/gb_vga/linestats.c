@@ -0,0 +1,104 @@
+#include "linestats.h"
+#include <string.h>
+#include "pico.h"
+#include "hardware/sync.h"
+
+static volatile linestats_t stats;
+
+// Newest scanline taken by either core, covered by taken_lock
+static spin_lock_t* taken_lock;
+static int frame_lines_out;
+static bool any_taken;
+static uint16_t newest_frame;
+static uint16_t newest_line;
+
+// Current frame, core 1 only
+static uint16_t frame_histogram[LINESTATS_BUCKETS];
+static uint32_t frame_lines;
+static uint32_t frame_cycles;
+static uint32_t frame_max;
+
+//**********************************************************************************************
+// PUBLIC FUNCTIONS
+//**********************************************************************************************
+void LINESTATS_record(uint32_t cycles)
+{
+    uint32_t bucket = cycles / LINESTATS_BUCKET_CYCLES;
+    bucket = bucket >= LINESTATS_BUCKETS ? LINESTATS_BUCKETS - 1 : bucket;
+
+    frame_histogram[bucket]++;
+    frame_lines++;
+    frame_cycles += cycles;
+    frame_max = cycles > frame_max ? cycles : frame_max;
+}
+
+void LINESTATS_init(int lines_per_frame)
+{
+    taken_lock = spin_lock_init(spin_lock_claim_unused(true));
+    frame_lines_out = lines_per_frame;
+    any_taken = false;
+}
+
+void __not_in_flash_func(LINESTATS_taken)(uint16_t frame, uint16_t line)
+{
+    uint32_t save = spin_lock_blocking(taken_lock);
+
+    int32_t ahead = (int16_t)(frame - newest_frame) * frame_lines_out + (line - newest_line);
+    if (!any_taken)
+    {
+        any_taken = true;
+        ahead = 1;
+    }
+
+    if (ahead > 0)
+    {
+        stats.late += ahead - 1;
+        newest_frame = frame;
+        newest_line = line;
+    }
+    else if (stats.late > 0)
+    {
+        // Counted as skipped when a later line was reported first.  Only the
+        // very first lines can come in behind without having been counted.
+        stats.late--;
+    }
+
+    spin_unlock(taken_lock, save);
+}
+
+void LINESTATS_end_frame(void)
+{
+    if (frame_lines == 0)
+        return;
+
+    // Walk down from the slowest bucket until 1% of the frame's lines are above us
+    uint32_t above = 0;
+    uint32_t limit = frame_lines / 100;
+    int bucket = LINESTATS_BUCKETS - 1;
+    while (bucket > 0 && above + frame_histogram[bucket] <= limit)
+    {
+        above += frame_histogram[bucket];
+        bucket--;
+    }
+
+    for (int i = 0; i < LINESTATS_BUCKETS; i++)
+    {
+        stats.histogram[i] += frame_histogram[i];
+    }
+
+    stats.lines += frame_lines;
+    stats.worst = frame_max > stats.worst ? frame_max : stats.worst;
+    stats.frame_avg = frame_cycles / frame_lines;
+    stats.frame_p99 = (bucket + 1) * LINESTATS_BUCKET_CYCLES;
+    stats.frame_max = frame_max;
+
+    memset(frame_histogram, 0, sizeof(frame_histogram));
+    frame_lines = 0;
+    frame_cycles = 0;
+    frame_max = 0;
+}
+
+void LINESTATS_get(linestats_t* out)
+{
+    memcpy(out, (const void*)&stats, sizeof(*out));
+}
@@ -0,0 +1,44 @@
+#ifndef LINESTATS_H
+#define LINESTATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Scanline render time histogram.  Core 1 records every line it generates;
+// anyone may read a snapshot.  Fields are single words written by core 1
+// only, except late, which both rendering cores update under a spin lock,
+// so a reader can see values from two neighbouring frames but never a torn
+// value.
+#define LINESTATS_BUCKETS           (32)
+#define LINESTATS_BUCKET_CYCLES     (512)
+
+typedef struct
+{
+    uint32_t lines;                 // scanlines timed since boot
+    uint32_t late;                  // scanlines scanvideo skipped because nobody took them in time
+    uint32_t worst;                 // slowest line since boot, cycles
+
+    // Last complete output frame, cycles
+    uint32_t frame_avg;
+    uint32_t frame_p99;             // upper edge of the bucket holding the 99th percentile
+    uint32_t frame_max;
+
+    uint32_t histogram[LINESTATS_BUCKETS];  // all lines since boot, last bucket also counts overflow
+} linestats_t;
+
+// lines_per_frame is the output mode's height
+void LINESTATS_init(int lines_per_frame);
+
+void LINESTATS_record(uint32_t cycles);
+
+// Every scanline either core takes from scanvideo.  When generation falls
+// behind, scanvideo moves it on past the lines whose time has come, so a
+// line nobody rendered shows up as a gap in the ids handed out.  The cores
+// may report the ids they took out of order; a line reported after a later
+// one fills its gap again, so late only counts while lines are being taken
+// and settles on the lines really skipped.
+void LINESTATS_taken(uint16_t frame, uint16_t line);
+void LINESTATS_end_frame(void);
+void LINESTATS_get(linestats_t* stats);
+
+#endif // LINESTATS_H
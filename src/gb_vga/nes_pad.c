@@ -0,0 +1,49 @@
+#include "nes_pad.h"
+#include "hardware/pio.h"
+#include "hardware/clocks.h"
+#include "nes_pad.pio.h"
+
+// pio1 is full with the LCD capture and the joypad, so this shares pio0
+// with scanvideo, which may leave no room
+#define NES_PAD_PIO         pio0
+#define NES_PAD_CYCLE_HZ    (1000*1000)
+
+static uint nes_pad_sm;
+
+//**********************************************************************************************
+// PUBLIC FUNCTIONS
+//**********************************************************************************************
+bool NES_PAD_init(uint8_t latch_pin, uint8_t clock_pin, uint8_t data_pin)
+{
+    if (!pio_can_add_program(NES_PAD_PIO, &nes_pad_program))
+        return false;
+
+    int sm = pio_claim_unused_sm(NES_PAD_PIO, false);
+    if (sm < 0)
+        return false;
+
+    nes_pad_sm = sm;
+    uint offset = pio_add_program(NES_PAD_PIO, &nes_pad_program);
+    nes_pad_program_init(NES_PAD_PIO, nes_pad_sm, offset, latch_pin, clock_pin, data_pin,
+                         (float)clock_get_hz(clk_sys) / NES_PAD_CYCLE_HZ);
+    pio_sm_set_enabled(NES_PAD_PIO, nes_pad_sm, true);
+    return true;
+}
+
+void NES_PAD_start(void)
+{
+    while (!pio_sm_is_rx_fifo_empty(NES_PAD_PIO, nes_pad_sm))
+    {
+        pio_sm_get(NES_PAD_PIO, nes_pad_sm);
+    }
+    pio_sm_put(NES_PAD_PIO, nes_pad_sm, 0);
+}
+
+bool NES_PAD_result(uint8_t* report)
+{
+    if (pio_sm_is_rx_fifo_empty(NES_PAD_PIO, nes_pad_sm))
+        return false;
+
+    *report = pio_sm_get(NES_PAD_PIO, nes_pad_sm) >> 24;
+    return true;
+}
@@ -0,0 +1,21 @@
+#ifndef NES_PAD_H
+#define NES_PAD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Original NES controller read by a PIO state machine: one call starts a
+// read, which takes ~110us, and the result is collected later without
+// waiting.  The report byte is decoded by controller_profile.h.
+//
+// false, with the pins left alone, if the PIO has no room for the program
+// or a state machine
+bool NES_PAD_init(uint8_t latch_pin, uint8_t clock_pin, uint8_t data_pin);
+
+// Starts a read; a result not yet collected is dropped
+void NES_PAD_start(void);
+
+// True once the read is done, with the pad's byte in *report
+bool NES_PAD_result(uint8_t* report);
+
+#endif // NES_PAD_H
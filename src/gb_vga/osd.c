@@ -1,574 +1,1127 @@
 #include "osd.h"
 #include <string.h>
+#include "hardware/sync.h"
 
-static uint8_t osd_pixel_buff[OSD_CHARS_PER_LINE];
+// Text and highlight as drawn.  Double buffered: OSD_commit() fills the
+// back one and flips, so a scanline never sees half an update.
+typedef struct
+{
+    char text[OSD_LINES][OSD_CHARS_PER_LINE+1];
+    int active_line;
+} osd_view_t;
+
+// osd_text and active_line are what the menu code edits; dirty_lines has a
+// bit per text line changed since the last commit.  osd_lock covers them
+// against a commit from the other core.
 static char osd_text[OSD_LINES][OSD_CHARS_PER_LINE+1];
-static bool osd_enabled = false;
 static int active_line = 0;
-static uint8_t* framebuffer = NULL;
+static uint16_t dirty_lines = 0;
+static osd_view_t osd_views[2];
+static volatile uint8_t shown_view = 0;
+static spin_lock_t* osd_lock = NULL;
+static bool osd_enabled = false;
 
-typedef struct 
+// Indexed by character code; codes without a glyph draw blank.  Glyphs are
+// 7 pixels wide, bit 6 leftmost, in the 5x6 cell at bits 5-1 and rows 1-6.
+// Lowercase descenders use row 7.
+static const uint8_t osd_font[OSD_FONT_GLYPHS][OSD_CHAR_HEIGHT] =
 {
-    char osd_char;
-    uint8_t data[OSD_CHAR_HEIGHT];
-} osd_char_data_t;
-
-//TODO: add more!
-static osd_char_data_t osd_letters[] = 
-{    
-    { 
-        .osd_char = ' ', 
-        .data = 
-        {
-            0b00000000,
-            0b00000000,
-            0b00000000,
-            0b00000000,
-            0b00000000,
-            0b00000000,
-            0b00000000,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = 'A', 
-        .data = 
-        {
-            0b00000000,
-            0b00011100,
-            0b00100010,
-            0b00100010,
-            0b00111110,
-            0b00100010,
-            0b00100010,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = 'B', 
-        .data = 
-        {
-            0b00000000,
-            0b00111100,
-            0b00100010,
-            0b00111100,
-            0b00100010,
-            0b00100010,
-            0b00111110,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = 'C', 
-        .data = 
-        {
-            0b00000000,
-            0b00011100,
-            0b00100010,
-            0b00100000,
-            0b00100000,
-            0b00100010,
-            0b00011100,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = 'D', 
-        .data = 
-        {
-            0b00000000,
-            0b00111100,
-            0b00100010,
-            0b00100010,
-            0b00100010,
-            0b00100010,
-            0b00111100,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = 'E', 
-        .data = 
-        {
-            0b00000000,
-            0b00111110,
-            0b00100000,
-            0b00111000,
-            0b00100000,
-            0b00100000,
-            0b00111110,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = 'F', 
-        .data = 
-        {
-            0b00000000,
-            0b00111110,
-            0b00100000,
-            0b00111000,
-            0b00100000,
-            0b00100000,
-            0b00100000,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = 'G', 
-        .data = 
-        {
-            0b00000000,
-            0b00011100,
-            0b00100010,
-            0b00100000,
-            0b00100110,
-            0b00100010,
-            0b00011100,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = 'H', 
-        .data = 
-        {
-            0b000000000,
-            0b00100010,
-            0b00100010,
-            0b00111110,
-            0b00100010,
-            0b00100010,
-            0b00100010,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = 'I', 
-        .data = 
-        {
-            0b00000000,
-            0b00111110,
-            0b00001000,
-            0b00001000,
-            0b00001000,
-            0b00001000,
-            0b00111110,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = 'J', 
-        .data = 
-        {
-            0b00000000,
-            0b00111110,
-            0b00000100,
-            0b00000100,
-            0b00000100,
-            0b00100100,
-            0b00111100,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = 'K', 
-        .data = 
-        {
-            0b00000000,
-            0b00100010,
-            0b00100100,
-            0b00111000,
-            0b00101000,
-            0b00100100,
-            0b00100010,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = 'L', 
-        .data = 
-        {
-            0b00000000,
-            0b00100000,
-            0b00100000,
-            0b00100000,
-            0b00100000,
-            0b00100000,
-            0b00111110,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = 'M', 
-        .data = 
-        {
-            0b00000000,
-            0b00100010,
-            0b00110110,
-            0b00101010,
-            0b00100010,
-            0b00100010,
-            0b00100010,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = 'N', 
-        .data = 
-        {
-            0b00000000,
-            0b00100010,
-            0b00110010,
-            0b00101010,
-            0b00100110,
-            0b00100010,
-            0b00100010,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = 'O', 
-        .data = 
-        {
-            0b00000000,
-            0b00011100,
-            0b00100010,
-            0b00100010,
-            0b00100010,
-            0b00100010,
-            0b00011100,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = 'P', 
-        .data = 
-        {
-            0b00000000,
-            0b00111100,
-            0b00100010,
-            0b00100010,
-            0b00111100,
-            0b00100000,
-            0b00100000,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = 'Q', 
-        .data = 
-        {
-            0b00000000,
-            0b00011100,
-            0b00100010,
-            0b00100010,
-            0b00100010,
-            0b00100110,
-            0b00011101,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = 'R', 
-        .data = 
-        {
-            0b00000000,
-            0b00111100,
-            0b00100010,
-            0b00111110,
-            0b00100100,
-            0b00100010,
-            0b00100010,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = 'S', 
-        .data = 
-        {
-            0b00000000,
-            0b00011100,
-            0b00100000,
-            0b00011000,
-            0b00001100,
-            0b00000010,
-            0b00111100,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = 'T', 
-        .data = 
-        {
-            0b00000000,
-            0b00111110,
-            0b00001000,
-            0b00001000,
-            0b00001000,
-            0b00001000,
-            0b00001000,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = 'U', 
-        .data = 
-        {
-            0b00000000,
-            0b00100010,
-            0b00100010,
-            0b00100010,
-            0b00100010,
-            0b00100010,
-            0b00011100,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = 'V', 
-        .data = 
-        {
-            0b00000000,
-            0b00100010,
-            0b00100010,
-            0b00100010,
-            0b00010100,
-            0b00001000,
-            0b00001000,
-            0b00000000
-        }
-    },
-        { 
-        .osd_char = 'W', 
-        .data = 
-        {
-            0b00000000,
-            0b00100010,
-            0b00100010,
-            0b00100010,
-            0b00101010,
-            0b00110110,
-            0b00100010,
-            0b00000000
-        }
-    },
-        { 
-        .osd_char = 'X', 
-        .data = 
-        {
-            0b00000000,
-            0b00100010,
-            0b00010100,
-            0b00001000,
-            0b00001000,
-            0b00010100,
-            0b00100010,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = 'Y', 
-        .data = 
-        {
-            0b00000000,
-            0b00100010,
-            0b00100010,
-            0b00010100,
-            0b00001000,
-            0b00001000,
-            0b00001000,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = 'Z', 
-        .data = 
-        {
-            0b00000000,
-            0b00111110,
-            0b00000100,
-            0b00001000,
-            0b00010000,
-            0b00100000,
-            0b00111110,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = '0', 
-        .data = 
-        {
-            0b00000000,
-            0b00011100,
-            0b00100110,
-            0b00101010,
-            0b00101010,
-            0b00110010,
-            0b00011100,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = '1', 
-        .data = 
-        {
-            0b00000000,
-            0b00001000,
-            0b00011000,
-            0b00101000,
-            0b00001000,
-            0b00001000,
-            0b00111110,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = '2', 
-        .data = 
-        {
-            0b00000000,
-            0b00011100,
-            0b00100010,
-            0b00000100,
-            0b00011000,
-            0b00100000,
-            0b00111110,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = '3', 
-        .data = 
-        {
-            0b00000000,
-            0b00111110,
-            0b00000010,
-            0b00011100,
-            0b00000010,
-            0b00100010,
-            0b00011100,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = '4', 
-        .data = 
-        {
-            0b00000000,
-            0b00100010,
-            0b00100010,
-            0b00111110,
-            0b00000010,
-            0b00000010,
-            0b00000010,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = '5', 
-        .data = 
-        {
-            0b00000000,
-            0b00111110,
-            0b00100000,
-            0b00111100,
-            0b00000010,
-            0b00100010,
-            0b00011100,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = '6', 
-        .data = 
-        {
-            0b00000000,
-            0b00011100,
-            0b00100000,
-            0b00111100,
-            0b00100010,
-            0b00100010,
-            0b00011100,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = '7', 
-        .data = 
-        {
-            0b00000000,
-            0b00111110,
-            0b00000010,
-            0b00000100,
-            0b00001000,
-            0b00010000,
-            0b00010000,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = '8', 
-        .data = 
-        {
-            0b00000000,
-            0b00011100,
-            0b00100010,
-            0b00011100,
-            0b00100010,
-            0b00100010,
-            0b00011100,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = '9', 
-        .data = 
-        {
-            0b00000000,
-            0b00011100,
-            0b00100010,
-            0b00100010,
-            0b00011110,
-            0b00000010,
-            0b00011100,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = '!', 
-        .data = 
-        {
-            0b00000000,
-            0b00001000,
-            0b00001000,
-            0b00001000,
-            0b00001000,
-            0b00000000,
-            0b00001000,
-            0b00000000
-        }
-    },
-    { 
-        .osd_char = ':', 
-        .data = 
-        {
-            0b00000000,
-            0b00000000,
-            0b00000000,
-            0b00010000,
-            0b00000000,
-            0b00010000,
-            0b00000000,
-            0b00000000
-        }
-    },
-    { .osd_char = '\0', .data = 0 }  // Keep this
+    [OSD_CHAR_ARROW_UP] =
+    {
+        0b00000000,
+        0b00001000,
+        0b00011100,
+        0b00101010,
+        0b00001000,
+        0b00001000,
+        0b00001000,
+        0b00000000
+    },
+    [OSD_CHAR_ARROW_DOWN] =
+    {
+        0b00000000,
+        0b00001000,
+        0b00001000,
+        0b00001000,
+        0b00101010,
+        0b00011100,
+        0b00001000,
+        0b00000000
+    },
+    [OSD_CHAR_ARROW_RIGHT] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00001000,
+        0b00000100,
+        0b00111110,
+        0b00000100,
+        0b00001000,
+        0b00000000
+    },
+    [OSD_CHAR_ARROW_LEFT] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00001000,
+        0b00010000,
+        0b00111110,
+        0b00010000,
+        0b00001000,
+        0b00000000
+    },
+    [' '] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00000000
+    },
+    ['!'] =
+    {
+        0b00000000,
+        0b00001000,
+        0b00001000,
+        0b00001000,
+        0b00001000,
+        0b00000000,
+        0b00001000,
+        0b00000000
+    },
+    ['"'] =
+    {
+        0b00000000,
+        0b00010100,
+        0b00010100,
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00000000
+    },
+    ['#'] =
+    {
+        0b00000000,
+        0b00010100,
+        0b00111110,
+        0b00010100,
+        0b00010100,
+        0b00111110,
+        0b00010100,
+        0b00000000
+    },
+    ['$'] =
+    {
+        0b00000000,
+        0b00001000,
+        0b00011110,
+        0b00101000,
+        0b00011100,
+        0b00001010,
+        0b00111100,
+        0b00001000
+    },
+    ['%'] =
+    {
+        0b00000000,
+        0b00110010,
+        0b00110100,
+        0b00001000,
+        0b00010000,
+        0b00100110,
+        0b00000110,
+        0b00000000
+    },
+    ['&'] =
+    {
+        0b00000000,
+        0b00011000,
+        0b00100100,
+        0b00011000,
+        0b00101010,
+        0b00100100,
+        0b00011010,
+        0b00000000
+    },
+    ['\''] =
+    {
+        0b00000000,
+        0b00001000,
+        0b00001000,
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00000000
+    },
+    ['('] =
+    {
+        0b00000000,
+        0b00000100,
+        0b00001000,
+        0b00001000,
+        0b00001000,
+        0b00001000,
+        0b00000100,
+        0b00000000
+    },
+    [')'] =
+    {
+        0b00000000,
+        0b00010000,
+        0b00001000,
+        0b00001000,
+        0b00001000,
+        0b00001000,
+        0b00010000,
+        0b00000000
+    },
+    ['*'] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00101010,
+        0b00011100,
+        0b00111110,
+        0b00011100,
+        0b00101010,
+        0b00000000
+    },
+    ['+'] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00001000,
+        0b00001000,
+        0b00111110,
+        0b00001000,
+        0b00001000,
+        0b00000000
+    },
+    [','] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00001000,
+        0b00001000,
+        0b00010000
+    },
+    ['-'] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00111110,
+        0b00000000,
+        0b00000000,
+        0b00000000
+    },
+    ['.'] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00001000,
+        0b00000000
+    },
+    ['/'] =
+    {
+        0b00000000,
+        0b00000010,
+        0b00000100,
+        0b00001000,
+        0b00010000,
+        0b00100000,
+        0b00000000,
+        0b00000000
+    },
+    ['0'] =
+    {
+        0b00000000,
+        0b00011100,
+        0b00100110,
+        0b00101010,
+        0b00101010,
+        0b00110010,
+        0b00011100,
+        0b00000000
+    },
+    ['1'] =
+    {
+        0b00000000,
+        0b00001000,
+        0b00011000,
+        0b00101000,
+        0b00001000,
+        0b00001000,
+        0b00111110,
+        0b00000000
+    },
+    ['2'] =
+    {
+        0b00000000,
+        0b00011100,
+        0b00100010,
+        0b00000100,
+        0b00011000,
+        0b00100000,
+        0b00111110,
+        0b00000000
+    },
+    ['3'] =
+    {
+        0b00000000,
+        0b00111110,
+        0b00000010,
+        0b00011100,
+        0b00000010,
+        0b00100010,
+        0b00011100,
+        0b00000000
+    },
+    ['4'] =
+    {
+        0b00000000,
+        0b00100010,
+        0b00100010,
+        0b00111110,
+        0b00000010,
+        0b00000010,
+        0b00000010,
+        0b00000000
+    },
+    ['5'] =
+    {
+        0b00000000,
+        0b00111110,
+        0b00100000,
+        0b00111100,
+        0b00000010,
+        0b00100010,
+        0b00011100,
+        0b00000000
+    },
+    ['6'] =
+    {
+        0b00000000,
+        0b00011100,
+        0b00100000,
+        0b00111100,
+        0b00100010,
+        0b00100010,
+        0b00011100,
+        0b00000000
+    },
+    ['7'] =
+    {
+        0b00000000,
+        0b00111110,
+        0b00000010,
+        0b00000100,
+        0b00001000,
+        0b00010000,
+        0b00010000,
+        0b00000000
+    },
+    ['8'] =
+    {
+        0b00000000,
+        0b00011100,
+        0b00100010,
+        0b00011100,
+        0b00100010,
+        0b00100010,
+        0b00011100,
+        0b00000000
+    },
+    ['9'] =
+    {
+        0b00000000,
+        0b00011100,
+        0b00100010,
+        0b00100010,
+        0b00011110,
+        0b00000010,
+        0b00011100,
+        0b00000000
+    },
+    [':'] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00010000,
+        0b00000000,
+        0b00010000,
+        0b00000000,
+        0b00000000
+    },
+    [';'] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00010000,
+        0b00000000,
+        0b00010000,
+        0b00010000,
+        0b00100000
+    },
+    ['<'] =
+    {
+        0b00000000,
+        0b00000100,
+        0b00001000,
+        0b00010000,
+        0b00010000,
+        0b00001000,
+        0b00000100,
+        0b00000000
+    },
+    ['='] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00111110,
+        0b00000000,
+        0b00111110,
+        0b00000000,
+        0b00000000
+    },
+    ['>'] =
+    {
+        0b00000000,
+        0b00010000,
+        0b00001000,
+        0b00000100,
+        0b00000100,
+        0b00001000,
+        0b00010000,
+        0b00000000
+    },
+    ['?'] =
+    {
+        0b00000000,
+        0b00011100,
+        0b00100010,
+        0b00000100,
+        0b00001000,
+        0b00000000,
+        0b00001000,
+        0b00000000
+    },
+    ['@'] =
+    {
+        0b00000000,
+        0b00011100,
+        0b00100010,
+        0b00101110,
+        0b00101010,
+        0b00101100,
+        0b00011100,
+        0b00000000
+    },
+    ['A'] =
+    {
+        0b00000000,
+        0b00011100,
+        0b00100010,
+        0b00100010,
+        0b00111110,
+        0b00100010,
+        0b00100010,
+        0b00000000
+    },
+    ['B'] =
+    {
+        0b00000000,
+        0b00111100,
+        0b00100010,
+        0b00111100,
+        0b00100010,
+        0b00100010,
+        0b00111110,
+        0b00000000
+    },
+    ['C'] =
+    {
+        0b00000000,
+        0b00011100,
+        0b00100010,
+        0b00100000,
+        0b00100000,
+        0b00100010,
+        0b00011100,
+        0b00000000
+    },
+    ['D'] =
+    {
+        0b00000000,
+        0b00111100,
+        0b00100010,
+        0b00100010,
+        0b00100010,
+        0b00100010,
+        0b00111100,
+        0b00000000
+    },
+    ['E'] =
+    {
+        0b00000000,
+        0b00111110,
+        0b00100000,
+        0b00111000,
+        0b00100000,
+        0b00100000,
+        0b00111110,
+        0b00000000
+    },
+    ['F'] =
+    {
+        0b00000000,
+        0b00111110,
+        0b00100000,
+        0b00111000,
+        0b00100000,
+        0b00100000,
+        0b00100000,
+        0b00000000
+    },
+    ['G'] =
+    {
+        0b00000000,
+        0b00011100,
+        0b00100010,
+        0b00100000,
+        0b00100110,
+        0b00100010,
+        0b00011100,
+        0b00000000
+    },
+    ['H'] =
+    {
+        0b00000000,
+        0b00100010,
+        0b00100010,
+        0b00111110,
+        0b00100010,
+        0b00100010,
+        0b00100010,
+        0b00000000
+    },
+    ['I'] =
+    {
+        0b00000000,
+        0b00111110,
+        0b00001000,
+        0b00001000,
+        0b00001000,
+        0b00001000,
+        0b00111110,
+        0b00000000
+    },
+    ['J'] =
+    {
+        0b00000000,
+        0b00111110,
+        0b00000100,
+        0b00000100,
+        0b00000100,
+        0b00100100,
+        0b00111100,
+        0b00000000
+    },
+    ['K'] =
+    {
+        0b00000000,
+        0b00100010,
+        0b00100100,
+        0b00111000,
+        0b00101000,
+        0b00100100,
+        0b00100010,
+        0b00000000
+    },
+    ['L'] =
+    {
+        0b00000000,
+        0b00100000,
+        0b00100000,
+        0b00100000,
+        0b00100000,
+        0b00100000,
+        0b00111110,
+        0b00000000
+    },
+    ['M'] =
+    {
+        0b00000000,
+        0b00100010,
+        0b00110110,
+        0b00101010,
+        0b00100010,
+        0b00100010,
+        0b00100010,
+        0b00000000
+    },
+    ['N'] =
+    {
+        0b00000000,
+        0b00100010,
+        0b00110010,
+        0b00101010,
+        0b00100110,
+        0b00100010,
+        0b00100010,
+        0b00000000
+    },
+    ['O'] =
+    {
+        0b00000000,
+        0b00011100,
+        0b00100010,
+        0b00100010,
+        0b00100010,
+        0b00100010,
+        0b00011100,
+        0b00000000
+    },
+    ['P'] =
+    {
+        0b00000000,
+        0b00111100,
+        0b00100010,
+        0b00100010,
+        0b00111100,
+        0b00100000,
+        0b00100000,
+        0b00000000
+    },
+    ['Q'] =
+    {
+        0b00000000,
+        0b00011100,
+        0b00100010,
+        0b00100010,
+        0b00100010,
+        0b00100110,
+        0b00011101,
+        0b00000000
+    },
+    ['R'] =
+    {
+        0b00000000,
+        0b00111100,
+        0b00100010,
+        0b00111110,
+        0b00100100,
+        0b00100010,
+        0b00100010,
+        0b00000000
+    },
+    ['S'] =
+    {
+        0b00000000,
+        0b00011100,
+        0b00100000,
+        0b00011000,
+        0b00001100,
+        0b00000010,
+        0b00111100,
+        0b00000000
+    },
+    ['T'] =
+    {
+        0b00000000,
+        0b00111110,
+        0b00001000,
+        0b00001000,
+        0b00001000,
+        0b00001000,
+        0b00001000,
+        0b00000000
+    },
+    ['U'] =
+    {
+        0b00000000,
+        0b00100010,
+        0b00100010,
+        0b00100010,
+        0b00100010,
+        0b00100010,
+        0b00011100,
+        0b00000000
+    },
+    ['V'] =
+    {
+        0b00000000,
+        0b00100010,
+        0b00100010,
+        0b00100010,
+        0b00010100,
+        0b00001000,
+        0b00001000,
+        0b00000000
+    },
+    ['W'] =
+    {
+        0b00000000,
+        0b00100010,
+        0b00100010,
+        0b00100010,
+        0b00101010,
+        0b00110110,
+        0b00100010,
+        0b00000000
+    },
+    ['X'] =
+    {
+        0b00000000,
+        0b00100010,
+        0b00010100,
+        0b00001000,
+        0b00001000,
+        0b00010100,
+        0b00100010,
+        0b00000000
+    },
+    ['Y'] =
+    {
+        0b00000000,
+        0b00100010,
+        0b00100010,
+        0b00010100,
+        0b00001000,
+        0b00001000,
+        0b00001000,
+        0b00000000
+    },
+    ['Z'] =
+    {
+        0b00000000,
+        0b00111110,
+        0b00000100,
+        0b00001000,
+        0b00010000,
+        0b00100000,
+        0b00111110,
+        0b00000000
+    },
+    ['['] =
+    {
+        0b00000000,
+        0b00001100,
+        0b00001000,
+        0b00001000,
+        0b00001000,
+        0b00001000,
+        0b00001100,
+        0b00000000
+    },
+    ['\\'] =
+    {
+        0b00000000,
+        0b00100000,
+        0b00010000,
+        0b00001000,
+        0b00000100,
+        0b00000010,
+        0b00000000,
+        0b00000000
+    },
+    [']'] =
+    {
+        0b00000000,
+        0b00011000,
+        0b00001000,
+        0b00001000,
+        0b00001000,
+        0b00001000,
+        0b00011000,
+        0b00000000
+    },
+    ['^'] =
+    {
+        0b00000000,
+        0b00001000,
+        0b00010100,
+        0b00100010,
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00000000
+    },
+    ['_'] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00111110,
+        0b00000000
+    },
+    ['`'] =
+    {
+        0b00000000,
+        0b00010000,
+        0b00001000,
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00000000
+    },
+    ['a'] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00011100,
+        0b00000010,
+        0b00011110,
+        0b00100010,
+        0b00011110,
+        0b00000000
+    },
+    ['b'] =
+    {
+        0b00000000,
+        0b00100000,
+        0b00100000,
+        0b00111100,
+        0b00100010,
+        0b00100010,
+        0b00111100,
+        0b00000000
+    },
+    ['c'] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00011100,
+        0b00100000,
+        0b00100000,
+        0b00100000,
+        0b00011100,
+        0b00000000
+    },
+    ['d'] =
+    {
+        0b00000000,
+        0b00000010,
+        0b00000010,
+        0b00011110,
+        0b00100010,
+        0b00100010,
+        0b00011110,
+        0b00000000
+    },
+    ['e'] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00011100,
+        0b00100010,
+        0b00111110,
+        0b00100000,
+        0b00011100,
+        0b00000000
+    },
+    ['f'] =
+    {
+        0b00000000,
+        0b00001100,
+        0b00010000,
+        0b00111100,
+        0b00010000,
+        0b00010000,
+        0b00010000,
+        0b00000000
+    },
+    ['g'] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00011110,
+        0b00100010,
+        0b00100010,
+        0b00011110,
+        0b00000010,
+        0b00011100
+    },
+    ['h'] =
+    {
+        0b00000000,
+        0b00100000,
+        0b00100000,
+        0b00111100,
+        0b00100010,
+        0b00100010,
+        0b00100010,
+        0b00000000
+    },
+    ['i'] =
+    {
+        0b00000000,
+        0b00001000,
+        0b00000000,
+        0b00011000,
+        0b00001000,
+        0b00001000,
+        0b00011100,
+        0b00000000
+    },
+    ['j'] =
+    {
+        0b00000000,
+        0b00000100,
+        0b00000000,
+        0b00001100,
+        0b00000100,
+        0b00000100,
+        0b00100100,
+        0b00011000
+    },
+    ['k'] =
+    {
+        0b00000000,
+        0b00100000,
+        0b00100100,
+        0b00101000,
+        0b00110000,
+        0b00101000,
+        0b00100100,
+        0b00000000
+    },
+    ['l'] =
+    {
+        0b00000000,
+        0b00011000,
+        0b00001000,
+        0b00001000,
+        0b00001000,
+        0b00001000,
+        0b00011100,
+        0b00000000
+    },
+    ['m'] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00110100,
+        0b00101010,
+        0b00101010,
+        0b00101010,
+        0b00100010,
+        0b00000000
+    },
+    ['n'] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00111100,
+        0b00100010,
+        0b00100010,
+        0b00100010,
+        0b00100010,
+        0b00000000
+    },
+    ['o'] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00011100,
+        0b00100010,
+        0b00100010,
+        0b00100010,
+        0b00011100,
+        0b00000000
+    },
+    ['p'] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00111100,
+        0b00100010,
+        0b00100010,
+        0b00111100,
+        0b00100000,
+        0b00100000
+    },
+    ['q'] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00011110,
+        0b00100010,
+        0b00100010,
+        0b00011110,
+        0b00000010,
+        0b00000010
+    },
+    ['r'] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00101100,
+        0b00110010,
+        0b00100000,
+        0b00100000,
+        0b00100000,
+        0b00000000
+    },
+    ['s'] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00011110,
+        0b00100000,
+        0b00011100,
+        0b00000010,
+        0b00111100,
+        0b00000000
+    },
+    ['t'] =
+    {
+        0b00000000,
+        0b00010000,
+        0b00111100,
+        0b00010000,
+        0b00010000,
+        0b00010010,
+        0b00001100,
+        0b00000000
+    },
+    ['u'] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00100010,
+        0b00100010,
+        0b00100010,
+        0b00100110,
+        0b00011010,
+        0b00000000
+    },
+    ['v'] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00100010,
+        0b00100010,
+        0b00100010,
+        0b00010100,
+        0b00001000,
+        0b00000000
+    },
+    ['w'] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00100010,
+        0b00101010,
+        0b00101010,
+        0b00101010,
+        0b00010100,
+        0b00000000
+    },
+    ['x'] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00100010,
+        0b00010100,
+        0b00001000,
+        0b00010100,
+        0b00100010,
+        0b00000000
+    },
+    ['y'] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00100010,
+        0b00100010,
+        0b00100010,
+        0b00011110,
+        0b00000010,
+        0b00011100
+    },
+    ['z'] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00111110,
+        0b00000100,
+        0b00001000,
+        0b00010000,
+        0b00111110,
+        0b00000000
+    },
+    ['{'] =
+    {
+        0b00000000,
+        0b00000100,
+        0b00001000,
+        0b00010000,
+        0b00001000,
+        0b00001000,
+        0b00000100,
+        0b00000000
+    },
+    ['|'] =
+    {
+        0b00000000,
+        0b00001000,
+        0b00001000,
+        0b00001000,
+        0b00001000,
+        0b00001000,
+        0b00001000,
+        0b00000000
+    },
+    ['}'] =
+    {
+        0b00000000,
+        0b00010000,
+        0b00001000,
+        0b00000100,
+        0b00001000,
+        0b00001000,
+        0b00010000,
+        0b00000000
+    },
+    ['~'] =
+    {
+        0b00000000,
+        0b00000000,
+        0b00000000,
+        0b00010010,
+        0b00101100,
+        0b00000000,
+        0b00000000,
+        0b00000000
+    }
 };
 
 //**********************************************************************************************
 // PRIVATE FUNCTION PROTOTYPES
 //**********************************************************************************************
-static uint8_t* get_char_data(char lookup_char);
+static const uint8_t* get_char_data(char lookup_char);
+static void set_active_line(int line);
 
 //**********************************************************************************************
 // PUBLIC FUNCTIONS
@@ -588,48 +1141,72 @@ void OSD_set_line_text(uint8_t line_index, const char* text)
     if (line_index >= OSD_LINES)
         return;
 
-    for (int i = 0; i < OSD_CHARS_PER_LINE; i++)
+    char line[OSD_CHARS_PER_LINE];
+    size_t length = strlen(text);
+    for (size_t i = 0; i < OSD_CHARS_PER_LINE; i++)
     {
-        osd_text[line_index][i] = i < strlen(text) ? text[i] : ' ';
+        line[i] = i < length ? text[i] : ' ';
     }
-    osd_text[line_index][OSD_CHARS_PER_LINE] = '\0';
+
+    // Rewriting the same text is common (every refresh) and costs nothing
+    if (memcmp(osd_text[line_index], line, OSD_CHARS_PER_LINE) == 0)
+        return;
+
+    uint32_t save = spin_lock_blocking(osd_lock);
+    memcpy(osd_text[line_index], line, OSD_CHARS_PER_LINE);
+    dirty_lines |= 1u << line_index;
+    spin_unlock(osd_lock, save);
 }
 
-void OSD_init(uint8_t* buffer)
+void OSD_init(void)
 {
-    framebuffer = buffer;
+    osd_lock = spin_lock_init(spin_lock_claim_unused(true));
+
+    for (int line = 0; line < OSD_LINES; line++)
+    {
+        memset(osd_text[line], ' ', OSD_CHARS_PER_LINE);
+        osd_text[line][OSD_CHARS_PER_LINE] = '\0';
+    }
+    active_line = 0;
+    osd_views[0] = (osd_view_t){ .active_line = 0 };
+    memcpy(osd_views[0].text, osd_text, sizeof(osd_text));
+    shown_view = 0;
+    dirty_lines = 0;
 }
 
-void OSD_update_framebuffer(void)
+uint16_t OSD_commit(void)
 {
-    if (framebuffer == NULL)
-        return;
+    if (osd_lock == NULL)
+        return 0;
+
+    uint32_t save = spin_lock_blocking(osd_lock);
+    uint16_t dirty = dirty_lines;
+    if (dirty != 0)
+    {
+        osd_view_t* back = &osd_views[shown_view ^ 1];
+        memcpy(back->text, osd_text, sizeof(osd_text));
+        back->active_line = active_line;
+        __dmb();
+        shown_view ^= 1;
+        dirty_lines = 0;
+    }
+    spin_unlock(osd_lock, save);
+
+    return dirty;
+}
+
+bool OSD_get_glyph_row(uint8_t y, uint8_t* glyph_rows)
+{
+    const osd_view_t* view = &osd_views[shown_view];
+    const char* text = view->text[y / OSD_CHAR_HEIGHT];
+    uint8_t n = y % OSD_CHAR_HEIGHT;
 
-    int pos = 0;
-    uint8_t color1 = 0x00;
-    uint8_t color2 = 0x3C;
-    for (int y = 0; y < OSD_LINES; y++)
-    {
-        for (int n = 0; n < OSD_CHAR_HEIGHT; n++)
-        {
-            for (int x = 0; x < OSD_CHARS_PER_LINE; x++)
-            {
-                char myChar = osd_text[y][x];
-                uint8_t* char_data = get_char_data(myChar);
-                for (int o = OSD_CHAR_WIDTH-1; o >= 0; o--)
-                {
-                    if (y == active_line)
-                    {
-                        framebuffer[pos++] = (((char_data[n] >> o) & 1) == 0) ? color2 : color1;
-                    }
-                    else
-                    {
-                        framebuffer[pos++] = (((char_data[n] >> o) & 1) == 0) ? color1 : color2;
-                    }
-                }
-            }
-        }
+    for (int x = 0; x < OSD_CHARS_PER_LINE; x++)
+    {
+        glyph_rows[x] = get_char_data(text[x])[n];
     }
+
+    return y / OSD_CHAR_HEIGHT == view->active_line;
 }
 
 uint8_t OSD_get_width(void)
@@ -659,11 +1236,11 @@ uint8_t OSD_get_line_count(void)
 
 void OSD_change_line(int direction)
 {
-    active_line += direction;
-    active_line = active_line >= OSD_LINES ? 0 : active_line;
-    active_line = active_line < 0 ? OSD_LINES-1 : active_line;
+    int line = active_line + direction;
+    line = line >= OSD_LINES ? 0 : line;
+    line = line < 0 ? OSD_LINES-1 : line;
 
-    OSD_update_framebuffer();
+    set_active_line(line);
 }
 
 int OSD_get_active_line(void)
@@ -671,21 +1248,32 @@ int OSD_get_active_line(void)
     return active_line;
 }
 
+void OSD_set_active_line(int line)
+{
+    if (line < 0 || line >= OSD_LINES)
+        return;
+
+    set_active_line(line);
+}
+
 //**********************************************************************************************
 // PRIVATE FUNCTIONS
 //**********************************************************************************************
-static uint8_t* get_char_data(char lookup_char)
+static const uint8_t* get_char_data(char lookup_char)
 {
-    int i = 0;
-    while (osd_letters[i].osd_char != '\0')
-    {
-        if (osd_letters[i].osd_char == lookup_char)
-            return osd_letters[i].data;
-        
-        i++;
-    }
-    
-    // not found, return blank (first element)
-    return osd_letters[0].data;
+    // Anything past the table draws as a space
+    uint8_t code = (uint8_t)lookup_char;
+    return osd_font[code < OSD_FONT_GLYPHS ? code : ' '];
 }
 
+// The old and new highlighted lines both need drawing again
+static void set_active_line(int line)
+{
+    if (line == active_line)
+        return;
+
+    uint32_t save = spin_lock_blocking(osd_lock);
+    dirty_lines |= (1u << active_line) | (1u << line);
+    active_line = line;
+    spin_unlock(osd_lock, save);
+}
@@ -3,20 +3,41 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdbool.h>
 
 #define OSD_CHAR_WIDTH      (7)
 #define OSD_CHAR_HEIGHT     (8)
-#define OSD_LINES           (6)
+#define OSD_LINES           (14)
 #define OSD_CHARS_PER_LINE  (18)
 #define OSD_HEIGHT          (OSD_LINES*OSD_CHAR_HEIGHT)
 #define OSD_WIDTH           (OSD_CHAR_WIDTH*OSD_CHARS_PER_LINE)
 
-void OSD_init(uint8_t* buffer);
+// RGB222 output pixels; the active line swaps them
+#define OSD_COLOR_BACKGROUND    (0x00)
+#define OSD_COLOR_TEXT          (0x3C)
+
+// Glyphs cover printable ASCII, plus arrows in the control codes
+#define OSD_FONT_GLYPHS         (128)
+#define OSD_CHAR_ARROW_UP       ('\x18')
+#define OSD_CHAR_ARROW_DOWN     ('\x19')
+#define OSD_CHAR_ARROW_RIGHT    ('\x1A')
+#define OSD_CHAR_ARROW_LEFT     ('\x1B')
+
+void OSD_init(void);
 bool OSD_is_enabled(void);
 void OSD_toggle(void);
 void OSD_set_line_text(uint8_t line_index, const char* text);
-void OSD_update_framebuffer(void);
+
+// Text and highlight changes are held back until OSD_commit(), which the
+// renderer calls between frames.  Returns a bit per text line that changed.
+uint16_t OSD_commit(void);
+
+// Fills glyph_rows with OSD pixel row y of the committed text, one byte per
+// character and bit 6 leftmost; a set bit is text.  Returns true on the
+// active line.
+bool OSD_get_glyph_row(uint8_t y, uint8_t* glyph_rows);
+
 uint8_t OSD_get_width(void);
 uint8_t OSD_get_height(void);
 uint8_t OSD_get_char_width(void);
@@ -24,5 +45,6 @@ uint8_t OSD_get_char_height(void);
 uint8_t OSD_get_line_count(void);
 void OSD_change_line(int direction);
 int OSD_get_active_line(void);
+void OSD_set_active_line(int line);
 
 #endif // OSD_H
\ No newline at end of file
@@ -0,0 +1,1631 @@
+#include "render.h"
+#include "osd.h"
+#include "frame_layout.h"
+#include "pico.h"
+#include "hardware/sync.h"
+#include "pico/scanvideo.h"
+#include "pico/scanvideo/composable_scanline.h"
+#include <string.h>
+
+#define MIN_RUN 3
+
+// Longest line single_scanline() emits in a cached mode: the play area as one
+// raw run plus the border / end-of-line tokens around it.  rle_line() never
+// needs more, as every extra raw run header sits next to a COLOR_RUN that
+// saved at least as much.  The cache is sized
+// for 3x; wider modes compose every line straight into the scanvideo buffer.
+#define LINE_CACHE_SCALE        (3)
+#define LINE_CACHE_WORDS        ((PIXELS_X*LINE_CACHE_SCALE + 12)/2)
+
+#define RGB888_TO_RGB222(r, g, b) ((((b)>>6u)<<PICO_SCANVIDEO_PIXEL_BSHIFT)|(((g)>>6u)<<PICO_SCANVIDEO_PIXEL_GSHIFT)|(((r)>>6u)<<PICO_SCANVIDEO_PIXEL_RSHIFT))
+
+static uint8_t border_colors[] = {
+    RGB888_TO_RGB222(0x00, 0x00, 0x00), // BLACK
+    RGB888_TO_RGB222(0x00, 0x00, 0xFF), // BLUE
+    RGB888_TO_RGB222(0xFF, 0xFF, 0xFF), // WHITE
+    RGB888_TO_RGB222(0x80, 0x80, 0x80), // LIGHT GREY
+    RGB888_TO_RGB222(0x40, 0x40, 0x40), // DARK GREY
+    RGB888_TO_RGB222(0xFF, 0x00, 0x00), // RED
+    RGB888_TO_RGB222(0x00, 0xFF, 0x00), // GREEN
+    RGB888_TO_RGB222(0xFF, 0xFF, 0x00), // YELLOW
+    RGB888_TO_RGB222(0xFF, 0x00, 0xFF), // PURPLE
+};
+
+static int scheme_offset = 0;
+static int scanline_color_offset = 0;
+static int video_effect = VIDEO_EFFECT_NONE;
+
+// frame on screen, latched from the frame store at the start of each output frame
+static const framestore_frame_t* volatile display_frame = NULL;
+static const framestore_frame_t* volatile previous_frame = NULL;
+static volatile uint16_t display_frame_number = 0;
+
+// Both cores render scanlines.  render_lock covers the per-frame latch and
+// claiming a line cache entry for writing; everything else is either per
+// core or only changed by core 0 between frames.
+static spin_lock_t* render_lock;
+
+// Composed scanline per Game Boy line.  An entry is reused for as long as the
+// line hash from capture and the line's state both match, so static screens
+// skip composition entirely.  The state is render_state, bumped by anything
+// that changes how every line is drawn: palette, border, effect, OSD on/off or
+// mode, plus line_state, bumped for just the lines under changed OSD text.
+// All the output lines of one Game Boy line copy from the same entry.
+//
+// sequence is odd while a core is composing into the entry.  Readers copy
+// out and check it didn't move; a core that finds the entry busy composes
+// straight into its own buffer instead of waiting.
+typedef struct
+{
+    volatile uint32_t sequence;
+    uint32_t hash;
+    uint32_t state;
+    uint32_t words;     // 0 = empty
+    volatile uint16_t frame;    // output frame the entry was last validated in
+    uint32_t data[LINE_CACHE_WORDS];
+} line_cache_entry_t;
+
+// Scale3x output: each Game Boy line as three rows of packed 2bpp output
+// pixels, double buffered.  It shares memory with the line cache, which is
+// off while the effect is on; select_line_store() hands the memory over at a
+// frame boundary and only once no pass is running.
+#define SMOOTH_SCALE            (3)
+#define SMOOTH_ROWS             (PIXELS_Y*SMOOTH_SCALE)
+#define SMOOTH_ROW_BYTES        (PIXELS_X*SMOOTH_SCALE/FRAME_PIXELS_PER_BYTE)
+#define SMOOTH_LINES_PER_STEP   (8)
+#define SMOOTH_NONE             (-1)
+
+// At 144 x 1004 bytes, the largest static buffer in the firmware;
+// ram_budget.ld checks the total
+static union
+{
+    line_cache_entry_t line_cache[PIXELS_Y];
+    uint8_t smooth_rows[2][SMOOTH_ROWS][SMOOTH_ROW_BYTES];
+} line_store;
+
+static volatile bool smooth_owns_store = false;
+static volatile bool smooth_busy = false;           // pass under way, store can't go back to the cache
+static volatile int8_t smooth_ready = SMOOTH_NONE;  // last finished buffer
+static volatile int8_t smooth_showing = SMOOTH_NONE;    // buffer latched for this output frame
+static const framestore_frame_t* smooth_source = NULL;
+static int8_t smooth_target = 0;
+static int smooth_next_line = 0;
+static volatile uint32_t render_state = 1;
+static volatile uint32_t line_state[PIXELS_Y];
+static uint32_t line_cache_hits[RENDER_CORES];
+static uint32_t line_cache_misses[RENDER_CORES];
+static uint32_t line_cache_replicas[RENDER_CORES];
+static uint32_t core_lines[RENDER_CORES];
+
+// packed framebuffer byte -> its four pixels as output pixels: palette and
+// pixel effect applied, scaled to the mode.  Rebuilt by set_byte_runs() when
+// the scheme, FX color, effect or mode changes, so the play area is a straight
+// copy.  Only the first run_length entries of a run are used.
+#define BYTE_RUN_MAX_LENGTH     (FRAME_PIXELS_PER_BYTE*RENDER_MAX_SCALE)
+static uint16_t byte_runs[256][BYTE_RUN_MAX_LENGTH];
+
+// Frame blend: two pixels of the current frame (low nibble) and the same two
+// of the previous frame (high nibble) -> their mixed colors, scaled to the
+// mode.  One lookup per two pixels, rebuilt alongside byte_runs.
+static uint16_t blend_runs[256][2*RENDER_MAX_SCALE];
+#define BLEND_CHANNEL(a, b, shift)  ((((((a) >> (shift)) & 3) + (((b) >> (shift)) & 3) + 1) / 2) << (shift))
+
+// One RGB222 channel of a and b mixed 1:3, rounded
+#define MIX_CHANNEL_1_3(a, b, shift) ((((((a) >> (shift)) & 3) + 3*(((b) >> (shift)) & 3) + 2) / 4) << (shift))
+
+// Line kernel for each Game Boy line, picked once per output frame by
+// select_line_kernels() so the per-pixel loops carry no OSD or effect checks
+typedef int32_t (*line_kernel_t)(uint32_t *buf, size_t buf_length, uint8_t mapped_y);
+static line_kernel_t line_kernels[PIXELS_Y];
+
+// rle_line() in place of the play kernel, see RENDER_set_rle_enabled()
+static bool rle_enabled = true;
+
+// Translucent OSD: active line x Game Boy shade x glyph bit -> the OSD
+// colour mixed with the shade in the current palette.  Rebuilt with
+// byte_runs.
+static bool osd_translucent = false;
+static uint16_t osd_blend[2][4][2];
+
+// Output line -> Game Boy line
+#define LINE_MAP_BORDER         (0xFFFF)
+#define LINE_MAP_FIRST          (0x8000)    // first output line of its Game Boy line, where the FX line goes
+#define LINE_MAP_Y_MASK         (0x00FF)
+
+typedef struct
+{
+    render_mode_info_t info;
+    line_kernel_t play_kernel;      // play_line() unrolled for this scale
+    line_kernel_t blend_kernel;     // blend_line() likewise
+    bool cached;                    // fits the line cache
+
+    // Precomputed by build_modes()
+    uint16_t border_horz;
+    uint16_t border_vert;
+    uint16_t left_run;              // COLOR_RUN counts for the borders and play area
+    uint16_t right_run;
+    uint16_t play_run;
+    uint8_t run_length;             // used entries of each byte_runs[] run
+    uint16_t line_map[RENDER_MAX_HEIGHT];
+} mode_entry_t;
+
+// OSD window in Game Boy pixels, updated alongside line_kernels
+static struct
+{
+    uint8_t start_x;
+    uint8_t end_x;
+    uint8_t start_y;
+    uint8_t end_y;
+} osd_window;
+
+#if RENDER_BENCHMARK
+// packed framebuffer byte -> its four shades
+static uint8_t unpack_lut[256][FRAME_PIXELS_PER_BYTE];
+#endif
+
+static int8_t border_color_index = 0;
+static uint16_t scanline_color = RGB888_TO_RGB222(0x00, 0x00, 0x00);
+
+static uint16_t colors[] = {
+    // Black and white
+    RGB888_TO_RGB222(0xF7, 0xF3, 0xF7),
+    RGB888_TO_RGB222(0xB5, 0xB2, 0xB5),
+    RGB888_TO_RGB222(0x4E, 0x4C, 0x4E),
+    RGB888_TO_RGB222(0x00, 0x00, 0x00),
+
+    // Inverted
+    RGB888_TO_RGB222(0x00, 0x00, 0x00),
+    RGB888_TO_RGB222(0x4E, 0x4C, 0x4E),
+    RGB888_TO_RGB222(0xB5, 0xB2, 0xB5),
+    RGB888_TO_RGB222(0xF7, 0xF3, 0xF7),
+
+    // DMG
+    RGB888_TO_RGB222(0x7B, 0x82, 0x10),
+    RGB888_TO_RGB222(0x5A, 0x79, 0x42),
+    RGB888_TO_RGB222(0x39, 0x59, 0x4A),
+    RGB888_TO_RGB222(0x29, 0x41, 0x39),
+
+    // Game Boy Pocket
+    RGB888_TO_RGB222(0xC6, 0xCB, 0xA5),
+    RGB888_TO_RGB222(0x8C, 0x92, 0x6B),
+    RGB888_TO_RGB222(0x4A, 0x51, 0x39),
+    RGB888_TO_RGB222(0x18, 0x18, 0x18),
+
+    // Game Boy Light
+    RGB888_TO_RGB222(0x00, 0xB2, 0x84),
+    RGB888_TO_RGB222(0x8C, 0x92, 0x6B),
+    RGB888_TO_RGB222(0x00, 0x69, 0x4A),
+    RGB888_TO_RGB222(0x00, 0x51, 0x39),
+
+    // SGB 1A
+    RGB888_TO_RGB222(0xF7, 0xE3, 0xC6),
+    RGB888_TO_RGB222(0xD6, 0x92, 0x4A),
+    RGB888_TO_RGB222(0xA5, 0x28, 0x21),
+    RGB888_TO_RGB222(0x31, 0x18, 0x52),
+
+    // SGB 2A
+    RGB888_TO_RGB222(0xEF, 0xC3, 0x9C),
+    RGB888_TO_RGB222(0xBD, 0x8A, 0x4A),
+    RGB888_TO_RGB222(0x29, 0x79, 0x00),
+    RGB888_TO_RGB222(0x00, 0x00, 0x00),
+
+    // SGB 3A
+    RGB888_TO_RGB222(0xF7, 0xCB, 0x94),
+    RGB888_TO_RGB222(0x73, 0xBA, 0xBD),
+    RGB888_TO_RGB222(0xF7, 0x61, 0x29),
+    RGB888_TO_RGB222(0x31, 0x49, 0x63),
+
+    // SGB 4A
+    RGB888_TO_RGB222(0xEF, 0xA2, 0x6B),
+    RGB888_TO_RGB222(0x7B, 0xA2, 0xF7),
+    RGB888_TO_RGB222(0xCE, 0x00, 0xCE),
+    RGB888_TO_RGB222(0x00, 0x00, 0x7B),
+
+    // SGB 1B
+    RGB888_TO_RGB222(0xD6, 0xD3, 0xBD),
+    RGB888_TO_RGB222(0xC6, 0xAA, 0x73),
+    RGB888_TO_RGB222(0xAD, 0x51, 0x10),
+    RGB888_TO_RGB222(0x00, 0x00, 0x00),
+
+    // SGB 2B
+    RGB888_TO_RGB222(0xF7, 0xF3, 0xF7),
+    RGB888_TO_RGB222(0xF7, 0xE3, 0x52),
+    RGB888_TO_RGB222(0xF7, 0x30, 0x00),
+    RGB888_TO_RGB222(0x52, 0x00, 0x5A),
+
+    // SGB 3B
+    RGB888_TO_RGB222(0xD6, 0xD3, 0xBD),
+    RGB888_TO_RGB222(0xDE, 0x82, 0x21),
+    RGB888_TO_RGB222(0x00, 0x51, 0x00),
+    RGB888_TO_RGB222(0x00, 0x10, 0x10),
+
+    // SGB 4B
+    RGB888_TO_RGB222(0xEF, 0xE3, 0xEF),
+    RGB888_TO_RGB222(0xE7, 0x9A, 0x63),
+    RGB888_TO_RGB222(0x42, 0x79, 0x39),
+    RGB888_TO_RGB222(0x18, 0x08, 0x08),
+
+    // SGB 1C
+    RGB888_TO_RGB222(0xF7, 0xBA, 0xF7),
+    RGB888_TO_RGB222(0xE7, 0x92, 0x52),
+    RGB888_TO_RGB222(0x94, 0x38, 0x63),
+    RGB888_TO_RGB222(0x39, 0x38, 0x94),
+
+    // SGB 2C
+    RGB888_TO_RGB222(0xF7, 0xF3, 0xF7),
+    RGB888_TO_RGB222(0xE7, 0x8A, 0x8C),
+    RGB888_TO_RGB222(0x7B, 0x30, 0xE7),
+    RGB888_TO_RGB222(0x29, 0x28, 0x94),
+
+    // SGB 3C
+    RGB888_TO_RGB222(0xDE, 0xA2, 0xC6),
+    RGB888_TO_RGB222(0xF7, 0xF3, 0x7B),
+    RGB888_TO_RGB222(0x00, 0xB2, 0xF7),
+    RGB888_TO_RGB222(0x21, 0x20, 0x5A),
+
+    // SGB 4C
+    RGB888_TO_RGB222(0xF7, 0xDB, 0xDE),
+    RGB888_TO_RGB222(0xF7, 0xF3, 0x7B),
+    RGB888_TO_RGB222(0x94, 0x9A, 0xDE),
+    RGB888_TO_RGB222(0x08, 0x00, 0x00),
+
+    // SGB 1D
+    RGB888_TO_RGB222(0xF7, 0xF3, 0xA5),
+    RGB888_TO_RGB222(0xBD, 0x82, 0x4A),
+    RGB888_TO_RGB222(0xF7, 0x00, 0x00),
+    RGB888_TO_RGB222(0x52, 0x18, 0x00),
+
+    // SGB 2D
+    RGB888_TO_RGB222(0xF7, 0xF3, 0x9C),
+    RGB888_TO_RGB222(0x00, 0xF3, 0x00),
+    RGB888_TO_RGB222(0xF7, 0x30, 0x00),
+    RGB888_TO_RGB222(0x00, 0x00, 0x52),
+
+    // SGB 3D
+    RGB888_TO_RGB222(0xEF, 0xF3, 0xB5),
+    RGB888_TO_RGB222(0xDE, 0xA2, 0x7B),
+    RGB888_TO_RGB222(0x96, 0xAD, 0x52),
+    RGB888_TO_RGB222(0x00, 0x00, 0x00),
+
+    // SGB 4D
+    RGB888_TO_RGB222(0xF7, 0xF3, 0xB5),
+    RGB888_TO_RGB222(0x94, 0xC3, 0xC6),
+    RGB888_TO_RGB222(0x4A, 0x69, 0x7B),
+    RGB888_TO_RGB222(0x08, 0x20, 0x4A),
+
+    // SGB 1E
+    RGB888_TO_RGB222(0xF7, 0xD3, 0xAD),
+    RGB888_TO_RGB222(0x7B, 0xBA, 0x7B),
+    RGB888_TO_RGB222(0x6B, 0x8A, 0x42),
+    RGB888_TO_RGB222(0x5A, 0x38, 0x21),
+
+    // SGB 2E
+    RGB888_TO_RGB222(0xF7, 0xC3, 0x84),
+    RGB888_TO_RGB222(0x94, 0xAA, 0xDE),
+    RGB888_TO_RGB222(0x29, 0x10, 0x63),
+    RGB888_TO_RGB222(0x10, 0x08, 0x10),
+
+    // SGB 3E
+    RGB888_TO_RGB222(0xF7, 0xF3, 0xBD),
+    RGB888_TO_RGB222(0xDE, 0xAA, 0x6B),
+    RGB888_TO_RGB222(0xAD, 0x79, 0x21),
+    RGB888_TO_RGB222(0x52, 0x49, 0x73),
+
+    // SGB 4E
+    RGB888_TO_RGB222(0xF7, 0xD3, 0xA5),
+    RGB888_TO_RGB222(0xDE, 0xA2, 0x7B),
+    RGB888_TO_RGB222(0x7B, 0x59, 0x8C),
+    RGB888_TO_RGB222(0x00, 0x20, 0x31),
+
+    // SGB 1F
+    RGB888_TO_RGB222(0xD6, 0xE3, 0xF7),
+    RGB888_TO_RGB222(0xDE, 0x8A, 0x52),
+    RGB888_TO_RGB222(0xA5, 0x00, 0x00),
+    RGB888_TO_RGB222(0x00, 0x41, 0x10),
+
+    // SGB 2F
+    RGB888_TO_RGB222(0xCE, 0xF3, 0xF7),
+    RGB888_TO_RGB222(0xF7, 0x92, 0x52),
+    RGB888_TO_RGB222(0x9C, 0x00, 0x00),
+    RGB888_TO_RGB222(0x18, 0x00, 0x00),
+
+    // SGB 3F
+    RGB888_TO_RGB222(0x7B, 0x79, 0xC6),
+    RGB888_TO_RGB222(0xF7, 0x69, 0xF7),
+    RGB888_TO_RGB222(0xF7, 0xCB, 0x00),
+    RGB888_TO_RGB222(0x42, 0x41, 0x42),
+
+    // SGB 4F
+    RGB888_TO_RGB222(0xB5, 0xCB, 0xCE),
+    RGB888_TO_RGB222(0xD6, 0x82, 0xD6),
+    RGB888_TO_RGB222(0x84, 0x00, 0x9C),
+    RGB888_TO_RGB222(0x39, 0x00, 0x00),
+
+    // SGB 1G
+    RGB888_TO_RGB222(0x00, 0x00, 0x52),
+    RGB888_TO_RGB222(0x00, 0x9A, 0xE7),
+    RGB888_TO_RGB222(0x7B, 0x79, 0x00),
+    RGB888_TO_RGB222(0xF7, 0xF3, 0x5A),
+
+    // SGB 2G
+    RGB888_TO_RGB222(0x6B, 0xB2, 0x39),
+    RGB888_TO_RGB222(0xDE, 0x51, 0x42),
+    RGB888_TO_RGB222(0xDE, 0xB2, 0x84),
+    RGB888_TO_RGB222(0x00, 0x18, 0x00),
+
+    // SGB 3G
+    RGB888_TO_RGB222(0x63, 0xD3, 0x52),
+    RGB888_TO_RGB222(0xF7, 0xF3, 0xF7),
+    RGB888_TO_RGB222(0xC6, 0x30, 0x39),
+    RGB888_TO_RGB222(0x39, 0x00, 0x00),
+
+    // SGB 4G
+    RGB888_TO_RGB222(0xAD, 0xDB, 0x18),
+    RGB888_TO_RGB222(0xB5, 0x20, 0x5A),
+    RGB888_TO_RGB222(0x29, 0x10, 0x00),
+    RGB888_TO_RGB222(0x00, 0x82, 0x63),
+
+    // SGB 1H
+    RGB888_TO_RGB222(0xF7, 0xE3, 0xDE),
+    RGB888_TO_RGB222(0xF7, 0xB2, 0x8C),
+    RGB888_TO_RGB222(0x84, 0x41, 0x00),
+    RGB888_TO_RGB222(0x31, 0x18, 0x00),
+
+    // SGB 2H
+    RGB888_TO_RGB222(0xF7, 0xF3, 0xF7),
+    RGB888_TO_RGB222(0xB5, 0xB2, 0xB5),
+    RGB888_TO_RGB222(0x73, 0x71, 0x73),
+    RGB888_TO_RGB222(0x00, 0x00, 0x00),
+
+    // SGB 3H
+    RGB888_TO_RGB222(0xDE, 0xF3, 0x9C),
+    RGB888_TO_RGB222(0x7B, 0xC3, 0x39),
+    RGB888_TO_RGB222(0x4A, 0x8A, 0x18),
+    RGB888_TO_RGB222(0x08, 0x18, 0x00),
+
+    // SGB 4H
+    RGB888_TO_RGB222(0xF7, 0xF3, 0xC6),
+    RGB888_TO_RGB222(0xB5, 0xBA, 0x5A),
+    RGB888_TO_RGB222(0x84, 0x8A, 0x42),
+    RGB888_TO_RGB222(0x42, 0x51, 0x29)
+};
+
+//**********************************************************************************************
+// PRIVATE FUNCTION PROTOTYPES
+//**********************************************************************************************
+static int32_t single_solid_line(uint32_t *buf, size_t buf_length, uint16_t color);
+static int32_t single_scanline(uint32_t *buf, size_t buf_length, uint8_t mapped_y);
+static int32_t cached_scanline(uint32_t *buf, size_t buf_length, uint8_t mapped_y);
+static void select_line_kernels(void);
+static int32_t play_line_2x(uint32_t *buf, size_t buf_length, uint8_t mapped_y);
+static int32_t play_line_3x(uint32_t *buf, size_t buf_length, uint8_t mapped_y);
+static int32_t play_line_4x(uint32_t *buf, size_t buf_length, uint8_t mapped_y);
+static int32_t blend_line_2x(uint32_t *buf, size_t buf_length, uint8_t mapped_y);
+static int32_t blend_line_3x(uint32_t *buf, size_t buf_length, uint8_t mapped_y);
+static int32_t blend_line_4x(uint32_t *buf, size_t buf_length, uint8_t mapped_y);
+static int32_t osd_row_line(uint32_t *buf, size_t buf_length, uint8_t mapped_y);
+static inline uint8_t osd_glyph_row(uint8_t mapped_y, uint8_t *glyph_rows, uint16_t *osd_colors);
+static inline uint8_t osd_bit(const uint8_t *glyph_rows, int osd_x);
+static int32_t rle_line(uint32_t *buf, size_t buf_length, uint8_t mapped_y);
+static void build_modes(void);
+static void select_line_store(void);
+static void invalidate_osd_lines(uint16_t dirty);
+static int32_t smooth_scanline(uint32_t *buf, int row, uint8_t mapped_y);
+static void smooth_line(const framestore_frame_t* src, uint8_t (*rows)[SMOOTH_ROW_BYTES], int y);
+static void set_byte_runs(void);
+#if RENDER_BENCHMARK
+static void set_unpack_lut(void);
+#endif
+
+static mode_entry_t modes[RENDER_MODE_COUNT] =
+{
+    [RENDER_MODE_640X480_3X] = {
+        .info = { .name = "640X480 3X", .width = 640, .height = 480, .scale = 3 },
+        .play_kernel = play_line_3x,
+        .blend_kernel = blend_line_3x,
+        .cached = true,
+    },
+    [RENDER_MODE_800X600_4X] = {
+        .info = { .name = "800X600 4X", .width = 800, .height = 600, .scale = 4 },
+        .play_kernel = play_line_4x,
+        .blend_kernel = blend_line_4x,
+        .cached = false,
+    },
+    [RENDER_MODE_640X480_2X] = {
+        .info = { .name = "640X480 2X", .width = 640, .height = 480, .scale = 2 },
+        .play_kernel = play_line_2x,
+        .blend_kernel = blend_line_2x,
+        .cached = true,
+    },
+};
+
+static const mode_entry_t* mode = &modes[RENDER_MODE_640X480_3X];
+
+//**********************************************************************************************
+// PUBLIC FUNCTIONS
+//**********************************************************************************************
+void RENDER_init(render_mode_t initial_mode)
+{
+    render_lock = spin_lock_init(spin_lock_claim_unused(true));
+
+    build_modes();
+#if RENDER_BENCHMARK
+    set_unpack_lut();
+#endif
+
+    RENDER_set_mode(initial_mode);
+    RENDER_change_scanline_color(0);
+}
+
+void RENDER_set_mode(render_mode_t new_mode)
+{
+    if (new_mode >= RENDER_MODE_COUNT)
+        return;
+
+    mode = &modes[new_mode];
+    set_byte_runs();
+    select_line_kernels();
+    RENDER_invalidate();
+}
+
+render_mode_t RENDER_get_mode(void)
+{
+    return (render_mode_t)(mode - modes);
+}
+
+const render_mode_info_t* RENDER_get_mode_info(render_mode_t m)
+{
+    return m < RENDER_MODE_COUNT ? &modes[m].info : NULL;
+}
+
+int32_t RENDER_scanline(uint32_t *buf, size_t buf_length, int line_num, uint16_t frame_num)
+{
+    // First line of a new frame from either core latches it.  Only ever move
+    // forwards: the other core may still be finishing a line of the last one.
+    if (display_frame == NULL || (int16_t)(frame_num - display_frame_number) > 0)
+    {
+        uint32_t save = spin_lock_blocking(render_lock);
+        if (display_frame == NULL || (int16_t)(frame_num - display_frame_number) > 0)
+        {
+            display_frame = FRAMESTORE_latch();
+            previous_frame = FRAMESTORE_get_previous();
+            select_line_kernels();
+            select_line_store();
+            invalidate_osd_lines(OSD_commit());
+            __dmb();
+            display_frame_number = frame_num;
+        }
+        spin_unlock(render_lock, save);
+    }
+
+    core_lines[get_core_num()]++;
+
+    uint16_t map = mode->line_map[line_num];
+
+    if (map == LINE_MAP_BORDER)
+    {
+         return single_solid_line(buf, buf_length, border_colors[border_color_index]);
+    }
+    else
+    {
+        if ((video_effect == VIDEO_EFFECT_PIXEL_EFFECT || video_effect == VIDEO_EFFECT_SCANLINES)
+            &&  (map & LINE_MAP_FIRST))
+        {
+            return single_solid_line(buf, buf_length, scanline_color);
+        }
+        else if (smooth_owns_store)
+        {
+            // Plain lines until the first Scale3x pass is done
+            return smooth_showing != SMOOTH_NONE
+                   ? smooth_scanline(buf, line_num - mode->border_vert, map & LINE_MAP_Y_MASK)
+                   : single_scanline(buf, buf_length, map & LINE_MAP_Y_MASK);
+        }
+        else if (mode->cached)
+        {
+            return cached_scanline(buf, buf_length, map & LINE_MAP_Y_MASK);
+        }
+        else
+        {
+            return single_scanline(buf, buf_length, map & LINE_MAP_Y_MASK);
+        }
+    }
+}
+
+int32_t RENDER_compose_line(uint32_t *buf, size_t buf_length, uint8_t mapped_y)
+{
+    return single_scanline(buf, buf_length, mapped_y);
+}
+
+void RENDER_set_rle_enabled(bool enabled)
+{
+    rle_enabled = enabled;
+    RENDER_invalidate();
+}
+
+bool RENDER_get_rle_enabled(void)
+{
+    return rle_enabled;
+}
+
+void RENDER_set_osd_translucent(bool translucent)
+{
+    osd_translucent = translucent;
+    RENDER_invalidate();
+}
+
+bool RENDER_get_osd_translucent(void)
+{
+    return osd_translucent;
+}
+
+const framestore_frame_t* RENDER_get_display_frame(void)
+{
+    return display_frame;
+}
+
+void RENDER_invalidate(void)
+{
+    render_state++;
+}
+
+void RENDER_change_scheme(int direction)
+{
+    int max_offset = sizeof(colors)/sizeof(colors[0]) - 4;
+    scheme_offset += direction * 4;
+    scheme_offset = scheme_offset > max_offset ? 0 : scheme_offset;
+    scheme_offset = scheme_offset < 0 ? max_offset : scheme_offset;
+    set_byte_runs();
+    RENDER_invalidate();
+}
+
+void RENDER_change_border_color(int direction)
+{
+    border_color_index += direction;
+    border_color_index = border_color_index < 0 ? (sizeof(border_colors)-1) : border_color_index;
+    border_color_index = border_color_index >= sizeof(border_colors) ? 0 : border_color_index;
+    RENDER_invalidate();
+}
+
+void RENDER_change_video_effect(int increment)
+{
+    video_effect += increment;
+    video_effect = video_effect >= VIDEO_EFFECT_COUNT ? VIDEO_EFFECT_NONE : video_effect;
+    video_effect = video_effect < 0 ? VIDEO_EFFECT_COUNT-1 : video_effect;
+
+    // Scale3x only exists at 3x
+    if (video_effect == VIDEO_EFFECT_SCALE3X && mode->info.scale != SMOOTH_SCALE && increment != 0)
+    {
+        RENDER_change_video_effect(increment > 0 ? 1 : -1);
+        return;
+    }
+
+    set_byte_runs();
+    RENDER_invalidate();
+}
+
+void RENDER_change_scanline_color(int increment)
+{
+    scanline_color_offset += increment;
+    scanline_color_offset = scanline_color_offset > 3 ? 0 : scanline_color_offset;
+    scanline_color_offset = scanline_color_offset < 0 ? 3 : scanline_color_offset;
+    scanline_color = colors[scheme_offset + scanline_color_offset];
+    set_byte_runs();
+    RENDER_invalidate();
+}
+
+int RENDER_get_scheme(void)
+{
+    return scheme_offset/4;
+}
+
+int RENDER_get_border_color(void)
+{
+    return border_color_index;
+}
+
+video_effect_t RENDER_get_video_effect(void)
+{
+    return video_effect;
+}
+
+int RENDER_get_scanline_color(void)
+{
+    return scanline_color_offset;
+}
+
+bool RENDER_smooth_step(void)
+{
+    if (smooth_next_line == 0)
+    {
+        // New frame on screen and a buffer free to write it into?
+        uint32_t save = spin_lock_blocking(render_lock);
+        int8_t target = smooth_ready == 0 ? 1 : 0;
+        if (smooth_owns_store && display_frame != NULL && display_frame != smooth_source
+            && target != smooth_showing)
+        {
+            smooth_busy = true;
+            smooth_source = display_frame;
+            smooth_target = target;
+        }
+        spin_unlock(render_lock, save);
+
+        if (!smooth_busy)
+            return false;
+    }
+
+    // The source stays out of capture's way for a frame after it leaves the
+    // screen, as the frame store's previous frame
+    int end = smooth_next_line + SMOOTH_LINES_PER_STEP;
+    end = end > PIXELS_Y ? PIXELS_Y : end;
+    for (int y = smooth_next_line; y < end; y++)
+    {
+        smooth_line(smooth_source, line_store.smooth_rows[smooth_target], y);
+    }
+    smooth_next_line = end;
+
+    if (smooth_next_line == PIXELS_Y)
+    {
+        __dmb();
+        smooth_ready = smooth_target;
+        smooth_busy = false;
+        smooth_next_line = 0;
+    }
+
+    return true;
+}
+
+void RENDER_get_stats(render_stats_t* stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+    for (int core = 0; core < RENDER_CORES; core++)
+    {
+        stats->line_cache_hits += line_cache_hits[core];
+        stats->line_cache_misses += line_cache_misses[core];
+        stats->line_cache_replicas += line_cache_replicas[core];
+        stats->core_lines[core] = core_lines[core];
+    }
+}
+
+#if RENDER_BENCHMARK
+int32_t RENDER_reference_line(uint32_t *buf, size_t buf_length, uint8_t mapped_y)
+{
+    uint16_t* p16 = (uint16_t *) buf;
+    uint16_t* first_pixel;
+
+    // LEFT BORDER
+    *p16++ = COMPOSABLE_COLOR_RUN;
+    *p16++ = border_colors[border_color_index];
+    *p16++ = mode->left_run;
+
+    // PLAY AREA
+    *p16++ = COMPOSABLE_RAW_RUN;
+    first_pixel = p16;
+    *p16++ = RGB888_TO_RGB222(0x00, 0xFF, 0x00); // replaced later - first pixel
+    *p16++ = mode->play_run;
+    
+    const uint8_t *pbuff = &display_frame->data[mapped_y * FRAME_LINE_BYTES];
+    uint8_t *shades = NULL;
+
+    int x,i;
+    uint16_t color = 0;
+    uint8_t osd_start_x = (PIXELS_X - OSD_get_width())/2;
+    uint8_t osd_end_x = osd_start_x + OSD_get_width();
+    uint8_t osd_start_y = (PIXELS_Y - OSD_get_height())/2;
+    uint8_t osd_end_y = osd_start_y + OSD_get_height();
+    bool in_osd = false;
+    int osd_pos = 0;
+    bool osd_row = OSD_is_enabled() & (mapped_y >= osd_start_y) & (mapped_y < osd_end_y);
+    uint8_t glyph_rows[OSD_CHARS_PER_LINE];
+    uint16_t osd_colors[2];
+
+    if (osd_row)
+    {
+        osd_glyph_row(mapped_y, glyph_rows, osd_colors);
+    }
+    for (x = 0; x < PIXELS_X; x++)
+    {
+        if ((x % FRAME_PIXELS_PER_BYTE) == 0)
+        {
+            shades = unpack_lut[*pbuff++];
+        }
+        uint8_t shade = shades[x % FRAME_PIXELS_PER_BYTE];
+
+        if (osd_row && (osd_pos >= 0))
+        {
+            in_osd = x >= osd_start_x && x < osd_end_x;
+        }
+
+        for (i = 0; i < mode->info.scale; i++)
+        {
+            if (x == 0 && i == 0)
+            {
+                *first_pixel = colors[shade + scheme_offset];
+            }
+            else
+            {
+                if (in_osd )
+                {
+                    color = osd_colors[osd_bit(glyph_rows, osd_pos)];
+                }
+                else
+                {
+                    // if pixel-effect enabled & last pixel...
+                    if ((video_effect == VIDEO_EFFECT_PIXEL_EFFECT) && i == mode->info.scale - 1)
+                    {
+                        color = scanline_color;
+                    }
+                    else
+                    {
+                        color = colors[shade + (uint8_t)scheme_offset]; 
+                    }
+                }
+
+                *p16++ = color; 
+            }
+        }
+        if (in_osd)
+        {
+            osd_pos++;
+        }
+    }
+   
+    // RIGHT BORDER
+    *p16++ = COMPOSABLE_COLOR_RUN;
+    *p16++ = border_colors[border_color_index]; 
+    *p16++ = mode->right_run;
+
+    // black pixel to end line
+    *p16++ = COMPOSABLE_RAW_1P;
+    *p16++ = 0;
+
+    *p16++ = COMPOSABLE_EOL_ALIGN;
+
+    return ((uint32_t *) p16) - buf;
+}
+#endif
+
+//**********************************************************************************************
+// PRIVATE FUNCTIONS
+//**********************************************************************************************
+static int32_t single_scanline(uint32_t *buf, size_t buf_length, uint8_t mapped_y)
+{
+    return line_kernels[mapped_y](buf, buf_length, mapped_y);
+}
+
+static void select_line_kernels(void)
+{
+    osd_window.start_x = (PIXELS_X - OSD_get_width())/2;
+    osd_window.end_x = osd_window.start_x + OSD_get_width();
+    osd_window.start_y = (PIXELS_Y - OSD_get_height())/2;
+    osd_window.end_y = osd_window.start_y + OSD_get_height();
+
+    bool osd_enabled = OSD_is_enabled();
+
+    // The pixel effect breaks every Game Boy pixel, so there is nothing to encode
+    line_kernel_t play_kernel = rle_enabled && video_effect != VIDEO_EFFECT_PIXEL_EFFECT
+                                ? rle_line : mode->play_kernel;
+    if (video_effect == VIDEO_EFFECT_FRAME_BLEND)
+    {
+        play_kernel = mode->blend_kernel;
+    }
+
+    for (int y = 0; y < PIXELS_Y; y++)
+    {
+        if (osd_enabled && y >= osd_window.start_y && y < osd_window.end_y)
+        {
+            line_kernels[y] = osd_row_line;
+        }
+        else
+        {
+            line_kernels[y] = play_kernel;
+        }
+    }
+}
+
+static inline uint16_t* begin_play_line(uint16_t *p16, uint16_t **first_pixel)
+{
+    // LEFT BORDER
+    *p16++ = COMPOSABLE_COLOR_RUN;
+    *p16++ = border_colors[border_color_index];
+    *p16++ = mode->left_run;
+
+    // PLAY AREA
+    *p16++ = COMPOSABLE_RAW_RUN;
+    *first_pixel = p16;
+    *p16++ = RGB888_TO_RGB222(0x00, 0xFF, 0x00); // replaced later - first pixel
+    *p16++ = mode->play_run;
+
+    return p16;
+}
+
+static inline int32_t end_play_line(uint32_t *buf, uint16_t *p16)
+{
+    // RIGHT BORDER
+    *p16++ = COMPOSABLE_COLOR_RUN;
+    *p16++ = border_colors[border_color_index]; 
+    *p16++ = mode->right_run;
+
+    // black pixel to end line
+    *p16++ = COMPOSABLE_RAW_1P;
+    *p16++ = 0;
+
+    // A raw run line is 10 halfwords of borders, run headers and end pixel
+    // plus one per play pixel, so an even play width (every mode's) ends it
+    // word aligned and needs the skip; a run-length encoded line can end
+    // either way
+    if (((uintptr_t) p16 & 2) == 0)
+    {
+        *p16++ = COMPOSABLE_EOL_SKIP_ALIGN;
+        *p16++ = 0;
+    }
+    else
+    {
+        *p16++ = COMPOSABLE_EOL_ALIGN;
+    }
+
+    return ((uint32_t *) p16) - buf;
+}
+
+// Copies output pixels [from, to) of a Game Boy line out of the byte run table
+static inline uint16_t* copy_runs(uint16_t *p16, const uint8_t *line, int from, int to)
+{
+    int run_length = mode->run_length;
+    int byte = from / run_length;
+    int i = from % run_length;
+
+    // Partial run up front, then whole runs, then the partial tail
+    if (i != 0)
+    {
+        const uint16_t *run = byte_runs[line[byte++]];
+        while (i < run_length && from < to)
+        {
+            *p16++ = run[i++];
+            from++;
+        }
+    }
+
+    while (to - from >= run_length)
+    {
+        const uint16_t *run = byte_runs[line[byte++]];
+        for (i = 0; i < run_length; i++)
+        {
+            *p16++ = run[i];
+        }
+        from += run_length;
+    }
+
+    if (from < to)
+    {
+        const uint16_t *run = byte_runs[line[byte]];
+        for (i = 0; from < to; i++, from++)
+        {
+            *p16++ = run[i];
+        }
+    }
+
+    return p16;
+}
+
+// copy_runs() through blend_runs, mixing in the previous frame's line
+static inline uint16_t* blend_copy_runs(uint16_t *p16, const uint8_t *line, const uint8_t *prev, int from, int to)
+{
+    int run_length = 2*mode->info.scale;
+
+    while (from < to)
+    {
+        int pair = from / run_length;
+        uint8_t current = line[pair / 2];
+        uint8_t previous = prev[pair / 2];
+        const uint16_t *run = blend_runs[(pair & 1) ? (current >> 4) | (previous & 0xF0)
+                                                    : (current & 0x0F) | ((previous << 4) & 0xF0)];
+
+        for (int i = from % run_length; i < run_length && from < to; i++, from++)
+        {
+            *p16++ = run[i];
+        }
+    }
+
+    return p16;
+}
+
+// Game Boy pixels only.  The pixel effect is already in the byte run table so
+// the same kernel serves both.  Inlined once per scale so the run copies
+// unroll to a fixed length.
+static inline __attribute__((always_inline)) int32_t play_line(uint32_t *buf, uint8_t mapped_y, const int run_length)
+{
+    uint16_t *first_pixel;
+    uint16_t *p16 = begin_play_line((uint16_t *) buf, &first_pixel);
+    const uint8_t *pbuff = &display_frame->data[mapped_y * FRAME_LINE_BYTES];
+    const uint16_t *run;
+    int x, i;
+
+    // Straight copy of each byte's run; the very first pixel rides in the raw run header
+    run = byte_runs[*pbuff++];
+    *first_pixel = run[0];
+    for (i = 1; i < run_length; i++)
+    {
+        *p16++ = run[i];
+    }
+
+    for (x = 1; x < FRAME_LINE_BYTES; x++)
+    {
+        run = byte_runs[*pbuff++];
+        for (i = 0; i < run_length; i++)
+        {
+            *p16++ = run[i];
+        }
+    }
+
+    return end_play_line(buf, p16);
+}
+
+// Game Boy pixels mixed with the previous frame through blend_runs, two
+// pixels per lookup
+static inline __attribute__((always_inline)) int32_t blend_line(uint32_t *buf, uint8_t mapped_y, const int run_length)
+{
+    uint16_t *first_pixel;
+    uint16_t *p16 = begin_play_line((uint16_t *) buf, &first_pixel);
+    const uint8_t *pbuff = &display_frame->data[mapped_y * FRAME_LINE_BYTES];
+    const uint8_t *pprev = &previous_frame->data[mapped_y * FRAME_LINE_BYTES];
+    const uint16_t *run;
+    int x, i;
+
+    // First pixel rides in the raw run header, as in play_line()
+    run = blend_runs[(pbuff[0] & 0x0F) | ((pprev[0] << 4) & 0xF0)];
+    *first_pixel = run[0];
+    for (i = 1; i < run_length; i++)
+    {
+        *p16++ = run[i];
+    }
+    run = blend_runs[(pbuff[0] >> 4) | (pprev[0] & 0xF0)];
+    for (i = 0; i < run_length; i++)
+    {
+        *p16++ = run[i];
+    }
+
+    for (x = 1; x < FRAME_LINE_BYTES; x++)
+    {
+        uint8_t current = pbuff[x];
+        uint8_t previous = pprev[x];
+
+        run = blend_runs[(current & 0x0F) | ((previous << 4) & 0xF0)];
+        for (i = 0; i < run_length; i++)
+        {
+            *p16++ = run[i];
+        }
+
+        run = blend_runs[(current >> 4) | (previous & 0xF0)];
+        for (i = 0; i < run_length; i++)
+        {
+            *p16++ = run[i];
+        }
+    }
+
+    return end_play_line(buf, p16);
+}
+
+static int32_t blend_line_2x(uint32_t *buf, size_t buf_length, uint8_t mapped_y)
+{
+    return blend_line(buf, mapped_y, 2*2);
+}
+
+static int32_t blend_line_3x(uint32_t *buf, size_t buf_length, uint8_t mapped_y)
+{
+    return blend_line(buf, mapped_y, 2*3);
+}
+
+static int32_t blend_line_4x(uint32_t *buf, size_t buf_length, uint8_t mapped_y)
+{
+    return blend_line(buf, mapped_y, 2*4);
+}
+
+static int32_t play_line_2x(uint32_t *buf, size_t buf_length, uint8_t mapped_y)
+{
+    return play_line(buf, mapped_y, FRAME_PIXELS_PER_BYTE*2);
+}
+
+static int32_t play_line_3x(uint32_t *buf, size_t buf_length, uint8_t mapped_y)
+{
+    return play_line(buf, mapped_y, FRAME_PIXELS_PER_BYTE*3);
+}
+
+static int32_t play_line_4x(uint32_t *buf, size_t buf_length, uint8_t mapped_y)
+{
+    return play_line(buf, mapped_y, FRAME_PIXELS_PER_BYTE*4);
+}
+
+// Game Boy pixels either side of the OSD window, blended as the play kernel
+// would with frame blend on.  The OSD is drawn without the pixel effect, so
+// this also covers OSD rows with the effect on.  The window never touches
+// column 0, so the first pixel is always a game pixel.
+static int32_t osd_row_line(uint32_t *buf, size_t buf_length, uint8_t mapped_y)
+{
+    uint16_t *first_pixel;
+    uint16_t *p16 = begin_play_line((uint16_t *) buf, &first_pixel);
+    const uint8_t *pbuff = &display_frame->data[mapped_y * FRAME_LINE_BYTES];
+    const uint8_t *pprev = &previous_frame->data[mapped_y * FRAME_LINE_BYTES];
+    bool blend = video_effect == VIDEO_EFFECT_FRAME_BLEND;
+    uint8_t glyph_rows[OSD_CHARS_PER_LINE];
+    uint16_t osd_colors[2];
+    int scale = mode->info.scale;
+    int gx = osd_window.start_x;
+    int c, o, i;
+
+    uint8_t swap = osd_glyph_row(mapped_y, glyph_rows, osd_colors);
+
+    if (blend)
+    {
+        blend_copy_runs(first_pixel, pbuff, pprev, 0, 1);
+        p16 = blend_copy_runs(p16, pbuff, pprev, 1, osd_window.start_x*scale);
+    }
+    else
+    {
+        *first_pixel = byte_runs[pbuff[0]][0];
+        p16 = copy_runs(p16, pbuff, 1, osd_window.start_x*scale);
+    }
+
+    for (c = 0; c < OSD_CHARS_PER_LINE; c++)
+    {
+        uint8_t bits = glyph_rows[c];
+        if (osd_translucent)
+        {
+            for (o = OSD_CHAR_WIDTH - 1; o >= 0; o--, gx++)
+            {
+                uint8_t shade = FRAME_PIXEL(pbuff[gx / FRAME_PIXELS_PER_BYTE], gx % FRAME_PIXELS_PER_BYTE);
+                uint16_t color = osd_blend[swap][shade][(bits >> o) & 1];
+                for (i = 0; i < scale; i++)
+                {
+                    *p16++ = color;
+                }
+            }
+        }
+        else
+        {
+            for (o = OSD_CHAR_WIDTH - 1; o >= 0; o--)
+            {
+                uint16_t color = osd_colors[(bits >> o) & 1];
+                for (i = 0; i < scale; i++)
+                {
+                    *p16++ = color;
+                }
+            }
+        }
+    }
+
+    if (blend)
+    {
+        p16 = blend_copy_runs(p16, pbuff, pprev, osd_window.end_x*scale, PIXELS_X*scale);
+    }
+    else
+    {
+        p16 = copy_runs(p16, pbuff, osd_window.end_x*scale, PIXELS_X*scale);
+    }
+
+    return end_play_line(buf, p16);
+}
+
+// The OSD row on Game Boy line mapped_y as packed glyph bits, and the
+// background and text colours they index, swapped on the active line.
+// Returns 1 on the active line, for indexing osd_blend.
+static inline uint8_t osd_glyph_row(uint8_t mapped_y, uint8_t *glyph_rows, uint16_t *osd_colors)
+{
+    bool active = OSD_get_glyph_row(mapped_y - osd_window.start_y, glyph_rows);
+
+    osd_colors[0] = active ? OSD_COLOR_TEXT : OSD_COLOR_BACKGROUND;
+    osd_colors[1] = active ? OSD_COLOR_BACKGROUND : OSD_COLOR_TEXT;
+
+    return active;
+}
+
+// Glyph bit of OSD pixel osd_x, counted from the window's left edge
+static inline uint8_t osd_bit(const uint8_t *glyph_rows, int osd_x)
+{
+    return (glyph_rows[osd_x / OSD_CHAR_WIDTH] >> (OSD_CHAR_WIDTH - 1 - osd_x % OSD_CHAR_WIDTH)) & 1;
+}
+
+// What a cache entry is checked against: the line hash, and with frame blend
+// the previous frame's too
+static inline uint32_t line_key(uint8_t mapped_y)
+{
+    uint32_t key = display_frame->line_hash[mapped_y];
+
+    if (video_effect == VIDEO_EFFECT_FRAME_BLEND)
+    {
+        key = (key * 16777619u) ^ previous_frame->line_hash[mapped_y];
+    }
+
+    return key;
+}
+
+static int32_t cached_scanline(uint32_t *buf, size_t buf_length, uint8_t mapped_y)
+{
+    line_cache_entry_t* entry = &line_store.line_cache[mapped_y];
+    uint32_t state = render_state + line_state[mapped_y];
+    uint16_t frame = display_frame_number;
+    uint32_t core = get_core_num();
+    uint32_t sequence = entry->sequence;
+    int32_t words;
+
+    __dmb();
+
+    if ((sequence & 1) == 0 && entry->words != 0 && entry->state == state)
+    {
+        // Repeat of a Game Boy line already checked this frame: the frame
+        // can't change under it, so skip the hash and just copy the words
+        bool replica = entry->frame == frame;
+
+        if (replica || entry->hash == line_key(mapped_y))
+        {
+            words = entry->words;
+            memcpy(buf, entry->data, words * sizeof(uint32_t));
+            __dmb();
+
+            if (entry->sequence == sequence)
+            {
+                entry->frame = frame;
+                if (replica)
+                    line_cache_replicas[core]++;
+                else
+                    line_cache_hits[core]++;
+                return words;
+            }
+        }
+    }
+
+    line_cache_misses[core]++;
+
+    // Claim the entry, unless the other core got there first
+    uint32_t save = spin_lock_blocking(render_lock);
+    bool claimed = (sequence & 1) == 0 && entry->sequence == sequence;
+    if (claimed)
+    {
+        entry->sequence = sequence + 1;
+    }
+    spin_unlock(render_lock, save);
+
+    if (!claimed)
+    {
+        return single_scanline(buf, buf_length, mapped_y);
+    }
+
+    // Compose straight into the cache and copy out below
+    __dmb();
+    words = single_scanline(entry->data, LINE_CACHE_WORDS, mapped_y);
+    entry->words = words;
+    entry->hash = line_key(mapped_y);
+    entry->state = state;
+    entry->frame = frame;
+    __dmb();
+    entry->sequence = sequence + 2;
+
+    memcpy(buf, entry->data, words * sizeof(uint32_t));
+
+    return words;
+}
+
+// Scale3x output row, with the OSD laid over it on OSD rows
+static int32_t smooth_scanline(uint32_t *buf, int row, uint8_t mapped_y)
+{
+    uint16_t *first_pixel;
+    uint16_t *p16 = begin_play_line((uint16_t *) buf, &first_pixel);
+    const uint8_t *prow = line_store.smooth_rows[smooth_showing][row];
+    int osd_from = SMOOTH_ROW_BYTES;
+    int osd_to = SMOOTH_ROW_BYTES;
+    int x;
+
+    // The OSD window starts and ends on whole packed bytes at 3x only if
+    // its edges are multiples of four; round outwards instead and let the
+    // OSD cover the odd pixels
+    if (line_kernels[mapped_y] == osd_row_line)
+    {
+        osd_from = osd_window.start_x * SMOOTH_SCALE / FRAME_PIXELS_PER_BYTE;
+        osd_to = (osd_window.end_x * SMOOTH_SCALE + FRAME_PIXELS_PER_BYTE - 1) / FRAME_PIXELS_PER_BYTE;
+    }
+
+    // byte_runs[b][n*3] is pixel n of b in the current palette.  The OSD
+    // never reaches the first byte, whose first pixel rides in the raw run
+    // header.
+    const uint16_t *first = byte_runs[prow[0]];
+    *first_pixel = first[0];
+    *p16++ = first[1*SMOOTH_SCALE];
+    *p16++ = first[2*SMOOTH_SCALE];
+    *p16++ = first[3*SMOOTH_SCALE];
+
+    for (x = 1; x < osd_from; x++)
+    {
+        const uint16_t *run = byte_runs[prow[x]];
+        *p16++ = run[0];
+        *p16++ = run[1*SMOOTH_SCALE];
+        *p16++ = run[2*SMOOTH_SCALE];
+        *p16++ = run[3*SMOOTH_SCALE];
+    }
+
+    if (osd_from < osd_to)
+    {
+        uint8_t glyph_rows[OSD_CHARS_PER_LINE];
+        uint16_t osd_colors[2];
+        int left = osd_window.start_x * SMOOTH_SCALE;
+        int right = osd_window.end_x * SMOOTH_SCALE;
+
+        uint8_t swap = osd_glyph_row(mapped_y, glyph_rows, osd_colors);
+
+        for (int px = osd_from * FRAME_PIXELS_PER_BYTE; px < osd_to * FRAME_PIXELS_PER_BYTE; px++)
+        {
+            if (px < left || px >= right)
+            {
+                *p16++ = byte_runs[prow[px / FRAME_PIXELS_PER_BYTE]][(px % FRAME_PIXELS_PER_BYTE) * SMOOTH_SCALE];
+            }
+            else if (osd_translucent)
+            {
+                // Over the smoothed picture, not the Game Boy pixel
+                uint8_t shade = FRAME_PIXEL(prow[px / FRAME_PIXELS_PER_BYTE], px % FRAME_PIXELS_PER_BYTE);
+                *p16++ = osd_blend[swap][shade][osd_bit(glyph_rows, (px - left) / SMOOTH_SCALE)];
+            }
+            else
+            {
+                *p16++ = osd_colors[osd_bit(glyph_rows, (px - left) / SMOOTH_SCALE)];
+            }
+        }
+
+        for (x = osd_to; x < SMOOTH_ROW_BYTES; x++)
+        {
+            const uint16_t *run = byte_runs[prow[x]];
+            *p16++ = run[0];
+            *p16++ = run[1*SMOOTH_SCALE];
+            *p16++ = run[2*SMOOTH_SCALE];
+            *p16++ = run[3*SMOOTH_SCALE];
+        }
+    }
+
+    return end_play_line(buf, p16);
+}
+
+// Hands the line cache memory to Scale3x while the effect is on, and back
+// once no pass is running.  Called under render_lock at each frame latch.
+static void select_line_store(void)
+{
+    bool smooth = video_effect == VIDEO_EFFECT_SCALE3X && mode->info.scale == SMOOTH_SCALE;
+
+    if (smooth && !smooth_owns_store)
+    {
+        smooth_owns_store = true;
+        smooth_ready = SMOOTH_NONE;
+        smooth_source = NULL;
+    }
+    else if (!smooth && smooth_owns_store && !smooth_busy)
+    {
+        // Empty, unclaimed entries; whatever else is in there is ignored
+        for (int y = 0; y < PIXELS_Y; y++)
+        {
+            line_store.line_cache[y].sequence = 0;
+            line_store.line_cache[y].words = 0;
+        }
+        smooth_owns_store = false;
+    }
+
+    smooth_showing = smooth_owns_store ? smooth_ready : SMOOTH_NONE;
+}
+
+// Game Boy lines under OSD text lines that changed in the last commit.  Called
+// under render_lock at each frame latch, after select_line_kernels().  A core
+// still composing one of them for the last frame keeps the old state, so its
+// entry can't be taken for the new text.
+static void invalidate_osd_lines(uint16_t dirty)
+{
+    for (int line = 0; dirty != 0; line++, dirty >>= 1)
+    {
+        if (dirty & 1)
+        {
+            int y = osd_window.start_y + line*OSD_CHAR_HEIGHT;
+            for (int n = 0; n < OSD_CHAR_HEIGHT; n++)
+            {
+                line_state[y + n]++;
+            }
+        }
+    }
+}
+
+// Shades of one Game Boy line, with the edge pixels repeated either side
+static inline void unpack_shades(const framestore_frame_t* src, int y, uint8_t *shades)
+{
+    const uint8_t *line = &src->data[y * FRAME_LINE_BYTES];
+
+    for (int x = 0; x < FRAME_LINE_BYTES; x++)
+    {
+        uint8_t b = line[x];
+        shades[x*4 + 1] = FRAME_PIXEL(b, 0);
+        shades[x*4 + 2] = FRAME_PIXEL(b, 1);
+        shades[x*4 + 3] = FRAME_PIXEL(b, 2);
+        shades[x*4 + 4] = FRAME_PIXEL(b, 3);
+    }
+    shades[0] = shades[1];
+    shades[PIXELS_X + 1] = shades[PIXELS_X];
+}
+
+// Scale3x of Game Boy line y into its three output rows.  Neighbours:
+//   A B C
+//   D E F
+//   G H I
+static void smooth_line(const framestore_frame_t* src, uint8_t (*rows)[SMOOTH_ROW_BYTES], int y)
+{
+    uint8_t above[PIXELS_X + 2];
+    uint8_t here[PIXELS_X + 2];
+    uint8_t below[PIXELS_X + 2];
+    uint8_t *out[SMOOTH_SCALE] = { rows[y*3], rows[y*3 + 1], rows[y*3 + 2] };
+    uint32_t bits[SMOOTH_SCALE] = { 0, 0, 0 };
+    int count = 0;
+
+    unpack_shades(src, y > 0 ? y - 1 : y, above);
+    unpack_shades(src, y, here);
+    unpack_shades(src, y < PIXELS_Y - 1 ? y + 1 : y, below);
+
+    for (int x = 1; x <= PIXELS_X; x++)
+    {
+        uint8_t a = above[x-1], b = above[x], c = above[x+1];
+        uint8_t d = here[x-1],  e = here[x],  f = here[x+1];
+        uint8_t g = below[x-1], h = below[x], i = below[x+1];
+        uint8_t e0 = e, e1 = e, e2 = e, e3 = e, e5 = e, e6 = e, e7 = e, e8 = e;
+
+        if (b != h && d != f)
+        {
+            e0 = d == b ? d : e;
+            e1 = (d == b && e != c) || (b == f && e != a) ? b : e;
+            e2 = b == f ? f : e;
+            e3 = (d == b && e != g) || (d == h && e != a) ? d : e;
+            e5 = (b == f && e != i) || (h == f && e != c) ? f : e;
+            e6 = d == h ? d : e;
+            e7 = (d == h && e != i) || (h == f && e != g) ? h : e;
+            e8 = h == f ? f : e;
+        }
+
+        // Leftmost pixel in the low bits, as in the frame store
+        bits[0] |= (uint32_t)(e0 | e1 << 2 | e2 << 4) << count;
+        bits[1] |= (uint32_t)(e3 | e  << 2 | e5 << 4) << count;
+        bits[2] |= (uint32_t)(e6 | e7 << 2 | e8 << 4) << count;
+        count += SMOOTH_SCALE * FRAME_BITS_PER_PIXEL;
+
+        while (count >= 8)
+        {
+            for (int r = 0; r < SMOOTH_SCALE; r++)
+            {
+                *out[r]++ = bits[r];
+                bits[r] >>= 8;
+            }
+            count -= 8;
+        }
+    }
+}
+
+// Raw run of Game Boy pixels [from, to)
+static inline uint16_t* raw_span(uint16_t *p16, const uint8_t *line, int from, int to)
+{
+    int scale = mode->info.scale;
+    int count = (to - from) * scale;
+
+    if (count == 0)
+        return p16;
+
+    const uint16_t *first = &byte_runs[line[from / FRAME_PIXELS_PER_BYTE]][(from % FRAME_PIXELS_PER_BYTE) * scale];
+
+    // One pixel at 2x is shorter than a raw run can be
+    if (count < MIN_RUN)
+    {
+        *p16++ = COMPOSABLE_RAW_2P;
+        *p16++ = first[0];
+        *p16++ = first[1];
+        return p16;
+    }
+
+    *p16++ = COMPOSABLE_RAW_RUN;
+    *p16++ = first[0];
+    *p16++ = count - MIN_RUN;
+
+    return copy_runs(p16, line, from*scale + 1, to*scale);
+}
+
+// Game Boy line as a COLOR_RUN per flat span, raw runs for whatever lies
+// between.  A span is found from whole bytes of one shade and then grown by
+// the matching pixels either side, so the scan is per byte and any span is
+// at least FRAME_PIXELS_PER_BYTE Game Boy pixels.
+static int32_t rle_line(uint32_t *buf, size_t buf_length, uint8_t mapped_y)
+{
+    const uint8_t *line = &display_frame->data[mapped_y * FRAME_LINE_BYTES];
+    uint16_t *p16 = (uint16_t *) buf;
+    int scale = mode->info.scale;
+    int raw_from = 0;
+    int byte = 0;
+
+    // LEFT BORDER
+    *p16++ = COMPOSABLE_COLOR_RUN;
+    *p16++ = border_colors[border_color_index];
+    *p16++ = mode->left_run;
+
+    while (byte < FRAME_LINE_BYTES)
+    {
+        uint8_t flat_byte = line[byte];
+        uint8_t shade = FRAME_PIXEL(flat_byte, 0);
+
+        if (flat_byte != shade * 0x55)
+        {
+            byte++;
+            continue;
+        }
+
+        int end = byte + 1;
+        while (end < FRAME_LINE_BYTES && line[end] == flat_byte)
+        {
+            end++;
+        }
+
+        int from = byte * FRAME_PIXELS_PER_BYTE;
+        int to = end * FRAME_PIXELS_PER_BYTE;
+        while (from > raw_from && FRAME_PIXEL(line[(from - 1) / FRAME_PIXELS_PER_BYTE], (from - 1) % FRAME_PIXELS_PER_BYTE) == shade)
+        {
+            from--;
+        }
+        while (to < PIXELS_X && FRAME_PIXEL(line[to / FRAME_PIXELS_PER_BYTE], to % FRAME_PIXELS_PER_BYTE) == shade)
+        {
+            to++;
+        }
+
+        p16 = raw_span(p16, line, raw_from, from);
+
+        *p16++ = COMPOSABLE_COLOR_RUN;
+        *p16++ = byte_runs[flat_byte][0];
+        *p16++ = (to - from) * scale - MIN_RUN;
+
+        raw_from = to;
+        byte = end;
+    }
+
+    p16 = raw_span(p16, line, raw_from, PIXELS_X);
+
+    return end_play_line(buf, p16);
+}
+
+static int32_t single_solid_line(uint32_t *buf, size_t buf_length, uint16_t color)
+{
+    uint16_t *p16 = (uint16_t *) buf;
+
+    // LEFT BORDER
+    *p16++ = COMPOSABLE_COLOR_RUN;
+    *p16++ = border_colors[border_color_index]; 
+    *p16++ = mode->left_run;
+
+    *p16++ = COMPOSABLE_COLOR_RUN;
+    *p16++ = color; 
+    *p16++ = mode->play_run;
+
+    //RIGHT BORDER
+    *p16++ = COMPOSABLE_COLOR_RUN;
+    *p16++ = border_colors[border_color_index]; 
+    *p16++ = mode->right_run;
+
+    // black pixel to end line
+    *p16++ = COMPOSABLE_RAW_1P;
+    *p16++ = 0;
+
+    *p16++ = COMPOSABLE_EOL_ALIGN;
+    
+    return ((uint32_t *) p16) - buf;
+}
+
+static void build_modes(void)
+{
+    for (int m = 0; m < RENDER_MODE_COUNT; m++)
+    {
+        mode_entry_t* entry = &modes[m];
+        uint8_t scale = entry->info.scale;
+
+        entry->border_horz = (entry->info.width - PIXELS_X*scale)/2;
+        entry->border_vert = (entry->info.height - PIXELS_Y*scale)/2;
+
+        // The end-of-line black pixel comes out of the left border's share
+        entry->left_run = entry->border_horz - MIN_RUN - 1;
+        entry->right_run = entry->border_horz - MIN_RUN;
+        entry->play_run = PIXELS_X*scale - MIN_RUN;
+        entry->run_length = FRAME_PIXELS_PER_BYTE*scale;
+
+        for (int line = 0; line < RENDER_MAX_HEIGHT; line++)
+        {
+            int y = line - entry->border_vert;
+
+            if (line >= entry->info.height || y < 0 || y >= PIXELS_Y*scale)
+            {
+                entry->line_map[line] = LINE_MAP_BORDER;
+            }
+            else
+            {
+                entry->line_map[line] = (y / scale) | ((y % scale) == 0 ? LINE_MAP_FIRST : 0);
+            }
+        }
+    }
+}
+
+static void set_byte_runs(void)
+{
+    int scale = mode->info.scale;
+
+    // Each shade pair mixed per RGB222 channel, rounding up
+    uint16_t blend_colors[4][4];
+    for (int current = 0; current < 4; current++)
+    {
+        for (int previous = 0; previous < 4; previous++)
+        {
+            uint16_t a = colors[current + scheme_offset];
+            uint16_t b = colors[previous + scheme_offset];
+
+            blend_colors[current][previous] = BLEND_CHANNEL(a, b, PICO_SCANVIDEO_PIXEL_RSHIFT)
+                                            | BLEND_CHANNEL(a, b, PICO_SCANVIDEO_PIXEL_GSHIFT)
+                                            | BLEND_CHANNEL(a, b, PICO_SCANVIDEO_PIXEL_BSHIFT);
+        }
+    }
+
+    // The OSD over each shade: its background mixed evenly, glyph pixels
+    // mostly OSD so the text stays readable over any shade
+    for (int active = 0; active < 2; active++)
+    {
+        uint16_t back = active ? OSD_COLOR_TEXT : OSD_COLOR_BACKGROUND;
+        uint16_t fore = active ? OSD_COLOR_BACKGROUND : OSD_COLOR_TEXT;
+
+        for (int shade = 0; shade < 4; shade++)
+        {
+            uint16_t a = colors[shade + scheme_offset];
+
+            osd_blend[active][shade][0] = BLEND_CHANNEL(a, back, PICO_SCANVIDEO_PIXEL_RSHIFT)
+                                        | BLEND_CHANNEL(a, back, PICO_SCANVIDEO_PIXEL_GSHIFT)
+                                        | BLEND_CHANNEL(a, back, PICO_SCANVIDEO_PIXEL_BSHIFT);
+            osd_blend[active][shade][1] = MIX_CHANNEL_1_3(a, fore, PICO_SCANVIDEO_PIXEL_RSHIFT)
+                                        | MIX_CHANNEL_1_3(a, fore, PICO_SCANVIDEO_PIXEL_GSHIFT)
+                                        | MIX_CHANNEL_1_3(a, fore, PICO_SCANVIDEO_PIXEL_BSHIFT);
+        }
+    }
+
+    for (int pair = 0; pair < 256; pair++)
+    {
+        uint16_t* run = blend_runs[pair];
+        for (int n = 0; n < 2; n++)
+        {
+            uint16_t color = blend_colors[FRAME_PIXEL(pair, n)][FRAME_PIXEL(pair >> 4, n)];
+            for (int i = 0; i < scale; i++)
+            {
+                *run++ = color;
+            }
+        }
+    }
+
+    for (int b = 0; b < 256; b++)
+    {
+        uint16_t* run = byte_runs[b];
+        for (int n = 0; n < FRAME_PIXELS_PER_BYTE; n++)
+        {
+            uint16_t color = colors[FRAME_PIXEL(b, n) + scheme_offset];
+            for (int i = 0; i < mode->info.scale; i++)
+            {
+                // pixel effect: last column of every pixel takes the FX color
+                if ((video_effect == VIDEO_EFFECT_PIXEL_EFFECT) && i == mode->info.scale - 1)
+                {
+                    *run++ = scanline_color;
+                }
+                else
+                {
+                    *run++ = color;
+                }
+            }
+        }
+    }
+}
+
+#if RENDER_BENCHMARK
+static void set_unpack_lut(void)
+{
+    for (int i = 0; i < 256; i++)
+    {
+        for (int n = 0; n < FRAME_PIXELS_PER_BYTE; n++)
+        {
+            unpack_lut[i][n] = FRAME_PIXEL(i, n);
+        }
+    }
+}
+#endif
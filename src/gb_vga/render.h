@@ -0,0 +1,105 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "framestore.h"
+
+// Cores that may call RENDER_scanline()
+#define RENDER_CORES            (2)
+
+// Largest output mode, for sizing buffers
+#define RENDER_MAX_SCALE        (4)
+#define RENDER_MAX_WIDTH        (800)
+#define RENDER_MAX_HEIGHT       (600)
+
+typedef enum
+{
+    RENDER_MODE_640X480_3X = 0,     // 480x432 game area
+    RENDER_MODE_800X600_4X,         // 640x576 game area
+    RENDER_MODE_640X480_2X,         // 320x288 game area, windowed
+    RENDER_MODE_COUNT
+} render_mode_t;
+
+typedef struct
+{
+    const char* name;               // OSD label
+    uint16_t width;                 // output pixels
+    uint16_t height;                // output lines
+    uint8_t scale;                  // output pixels per Game Boy pixel, both ways
+} render_mode_info_t;
+
+typedef enum
+{
+    VIDEO_EFFECT_NONE = 0,
+    VIDEO_EFFECT_PIXEL_EFFECT,
+    VIDEO_EFFECT_SCANLINES,
+    VIDEO_EFFECT_FRAME_BLEND,       // current and previous frame mixed, like the DMG LCD's slow response
+    VIDEO_EFFECT_SCALE3X,           // edge smoothing, 3x modes only
+    VIDEO_EFFECT_COUNT
+} video_effect_t;
+
+typedef struct
+{
+    uint32_t line_cache_hits;       // unchanged Game Boy line reused from an earlier frame
+    uint32_t line_cache_misses;     // Game Boy line composed from scratch
+    uint32_t line_cache_replicas;   // 2nd and later output line of a Game Boy line
+    uint32_t core_lines[RENDER_CORES];  // output lines rendered by each core
+} render_stats_t;
+
+void RENDER_init(render_mode_t mode);
+
+// Output geometry.  The caller sets scanvideo up to match.
+void RENDER_set_mode(render_mode_t mode);
+render_mode_t RENDER_get_mode(void);
+const render_mode_info_t* RENDER_get_mode_info(render_mode_t mode);
+
+// Fills buf with the composable scanline tokens for output line line_num and
+// returns the number of words used.  A change of frame_num latches the next
+// frame from the frame store.  Safe to call from both cores at once.
+int32_t RENDER_scanline(uint32_t *buf, size_t buf_length, int line_num, uint16_t frame_num);
+
+// Composes one Game Boy line of the frame on screen, bypassing the line cache
+int32_t RENDER_compose_line(uint32_t *buf, size_t buf_length, uint8_t mapped_y);
+const framestore_frame_t* RENDER_get_display_frame(void);
+
+// Call after anything outside the renderer that changes how lines are drawn,
+// e.g. showing or hiding the OSD.  OSD text changes need no call: they are
+// committed at the next frame and only redraw the lines they touch.
+void RENDER_invalidate(void);
+
+void RENDER_change_scheme(int direction);
+void RENDER_change_border_color(int direction);
+void RENDER_change_video_effect(int increment);
+void RENDER_change_scanline_color(int increment);
+int RENDER_get_scheme(void);
+int RENDER_get_border_color(void);
+video_effect_t RENDER_get_video_effect(void);
+int RENDER_get_scanline_color(void);
+
+void RENDER_get_stats(render_stats_t* stats);
+
+// Scale3x pass for VIDEO_EFFECT_SCALE3X, a few Game Boy lines per call.
+// Call from the core not busy with scanlines whenever it is idle; a pass
+// starts on each new frame and must finish within a frame.  Returns true
+// while there is work in hand.
+bool RENDER_smooth_step(void);
+
+// Flat spans of a line as COLOR_RUN tokens instead of raw pixels.  Fewer
+// buffer words and PIO pushes per line; the pixel effect and OSD rows are
+// always raw.
+void RENDER_set_rle_enabled(bool enabled);
+bool RENDER_get_rle_enabled(void);
+
+// OSD mixed half and half with the picture under it instead of drawn solid,
+// so the palette being picked stays visible
+void RENDER_set_osd_translucent(bool translucent);
+bool RENDER_get_osd_translucent(void);
+
+#if RENDER_BENCHMARK
+// single_scanline() as it was before the byte run table, kept to compare against
+int32_t RENDER_reference_line(uint32_t *buf, size_t buf_length, uint8_t mapped_y);
+#endif
+
+#endif // RENDER_H
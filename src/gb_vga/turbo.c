@@ -0,0 +1,179 @@
+#include "turbo.h"
+
+#define TURBO_BUTTONS   (2)
+
+// Held for on reads, let go for off.  Named for a game reading the joypad
+// once a frame, as nearly all do.
+typedef struct
+{
+    const char* name;
+    uint8_t on;
+    uint8_t off;
+} turbo_rate_t;
+
+// Played over and over while the macro button is held, a step per read
+typedef struct
+{
+    const char* name;
+    uint8_t steps;
+    uint16_t buttons[2];
+} turbo_macro_t;
+
+#define A       (1 << BUTTON_A)
+#define B       (1 << BUTTON_B)
+#define SELECT  (1 << BUTTON_SELECT)
+#define START   (1 << BUTTON_START)
+
+static const turbo_rate_t rates[] =
+{
+    { "OFF",    0, 0 },
+    { "30 HZ",  1, 1 },
+    { "20 HZ",  1, 2 },
+    { "15 HZ",  2, 2 },
+};
+
+static const turbo_macro_t macros[] =
+{
+    { "OFF",        1, { 0 } },
+    { "A+B",        1, { A | B } },
+    { "SOFT RESET", 1, { A | B | SELECT | START } },    // still subject to joypad.c's guard
+    { "A/B ALT",    2, { A, B } },
+};
+
+#define RATE_COUNT      (sizeof(rates)/sizeof(rates[0]))
+#define MACRO_COUNT     (sizeof(macros)/sizeof(macros[0]))
+
+static const controller_button_t turbo_buttons[TURBO_BUTTONS] = { BUTTON_A, BUTTON_B };
+static int rate_index[TURBO_BUTTONS] = { 0, 0 };
+static int macro_index = 0;
+
+// Two copies: the one not published is rebuilt, then swapped in with one store
+static turbo_table_t tables[2] = { { .phases = 1 }, { .phases = 1 } };
+static volatile int active = 0;
+
+//**********************************************************************************************
+// PRIVATE FUNCTION PROTOTYPES
+//**********************************************************************************************
+static int turbo_slot(controller_button_t button);
+static void compile(void);
+static int lcm(int a, int b);
+
+//**********************************************************************************************
+// PUBLIC FUNCTIONS
+//**********************************************************************************************
+void TURBO_change_rate(controller_button_t button, int direction)
+{
+    int slot = turbo_slot(button);
+    if (slot < 0)
+        return;
+
+    rate_index[slot] = (rate_index[slot] + direction + RATE_COUNT) % RATE_COUNT;
+    compile();
+}
+
+void TURBO_change_macro(int direction)
+{
+    macro_index = (macro_index + direction + MACRO_COUNT) % MACRO_COUNT;
+    compile();
+}
+
+int TURBO_get_rate(controller_button_t button)
+{
+    int slot = turbo_slot(button);
+    return slot < 0 ? 0 : rate_index[slot];
+}
+
+int TURBO_get_macro(void)
+{
+    return macro_index;
+}
+
+const char* TURBO_get_rate_name(controller_button_t button)
+{
+    int slot = turbo_slot(button);
+    return rates[slot < 0 ? 0 : rate_index[slot]].name;
+}
+
+const char* TURBO_get_macro_name(void)
+{
+    return macros[macro_index].name;
+}
+
+const turbo_table_t* TURBO_get_table(void)
+{
+    return &tables[active];
+}
+
+int TURBO_expand(const turbo_table_t* table, uint16_t pressed, uint16_t shown[TURBO_MAX_PHASES])
+{
+    bool macro = pressed & (1 << BUTTON_MACRO);
+
+    for (int phase = 0; phase < table->phases; phase++)
+    {
+        shown[phase] = (pressed & ~table->release[phase]) | (macro ? table->macro[phase] : 0);
+    }
+    return table->phases;
+}
+
+//**********************************************************************************************
+// PRIVATE FUNCTIONS
+//**********************************************************************************************
+static int turbo_slot(controller_button_t button)
+{
+    for (int i = 0; i < TURBO_BUTTONS; i++)
+    {
+        if (turbo_buttons[i] == button)
+            return i;
+    }
+    return -1;
+}
+
+// Every setting's cycle divides the table's, so each read of it is one
+// mask lookup.  Phase 0 has every turbo button held, so a cycle restarted
+// on a press shows it at once.
+static void compile(void)
+{
+    turbo_table_t* table = &tables[!active];
+    const turbo_macro_t* macro = &macros[macro_index];
+    int phases = macro->steps;
+
+    table->turbo = 0;
+    for (int i = 0; i < TURBO_BUTTONS; i++)
+    {
+        const turbo_rate_t* rate = &rates[rate_index[i]];
+        if (rate->on)
+        {
+            phases = lcm(phases, rate->on + rate->off);
+            table->turbo |= 1 << turbo_buttons[i];
+        }
+    }
+
+    table->phases = phases;
+    for (int phase = 0; phase < phases; phase++)
+    {
+        table->release[phase] = 0;
+        for (int i = 0; i < TURBO_BUTTONS; i++)
+        {
+            const turbo_rate_t* rate = &rates[rate_index[i]];
+            if (rate->on && phase % (rate->on + rate->off) >= rate->on)
+            {
+                table->release[phase] |= 1 << turbo_buttons[i];
+            }
+        }
+        table->macro[phase] = macro->buttons[phase % macro->steps];
+    }
+
+    active = !active;
+}
+
+static int lcm(int a, int b)
+{
+    int x = a, y = b;
+    while (y)
+    {
+        int t = x % y;
+        x = y;
+        y = t;
+    }
+    return a / x * b;
+}
@@ -0,0 +1,47 @@
+#ifndef TURBO_H
+#define TURBO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "controller.h"
+
+// Turbo A/B and button macros, stepped by the game's joypad reads rather
+// than by time, so a rate is exact in frames whatever the poll timing.
+//
+// The settings are compiled into a table of per-read masks, one entry per
+// read of the shortest cycle that repeats every setting.  joypad.c expands
+// the live buttons through it into one pin word per read when the buttons
+// change, and the read handler only steps to the next word.
+#define TURBO_MAX_PHASES    (12)        // covers every mix of 2, 3 and 4 read cycles
+
+typedef struct
+{
+    uint8_t phases;                     // reads per cycle, at least 1
+    uint16_t turbo;                     // buttons with turbo on
+    uint16_t release[TURBO_MAX_PHASES]; // turbo buttons let go of at this read
+    uint16_t macro[TURBO_MAX_PHASES];   // added while BUTTON_MACRO is held
+} turbo_table_t;
+
+// Turbo rates and macros step through their presets, wrapping like the
+// other menu settings.  Only A and B have turbo.
+void TURBO_change_rate(controller_button_t button, int direction);
+void TURBO_change_macro(int direction);
+
+// Preset indexes, to carry the settings across a reboot
+int TURBO_get_rate(controller_button_t button);
+int TURBO_get_macro(void);
+
+// For the OSD, at most 10 characters
+const char* TURBO_get_rate_name(controller_button_t button);
+const char* TURBO_get_macro_name(void);
+
+// The compiled table.  Recompiled on the calling core when a setting
+// changes, into a second copy, so a reader in an interrupt on that core
+// always sees a whole one.
+const turbo_table_t* TURBO_get_table(void);
+
+// Buttons shown at each read of the cycle for the live buttons; returns
+// the number of reads filled in
+int TURBO_expand(const turbo_table_t* table, uint16_t pressed, uint16_t shown[TURBO_MAX_PHASES]);
+
+#endif // TURBO_H